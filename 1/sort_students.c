@@ -0,0 +1,622 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+/*
+ * Large roster mode for the question1 flow
+ * question1 reads 10 names into a fixed stack array, sorts them with strcmp
+ * and strcpy swaps and writes sorted_students.txt. This program does the
+ * readFromFile -> sortNames -> write steps for rosters of any size in a
+ * bounded amount of memory:
+ *
+ *  1. students.txt is read in big blocks into an arena. Each name is a slice
+ *     (pointer + length) into the arena, nothing is copied into fixed buffers.
+ *  2. When the arena or the slice table is full the chunk is sorted. The
+ *     slices are split between threads, each sorts its share with an LSD radix
+ *     sort on an 8-byte key taken from the name, going 8 bytes deeper only
+ *     for groups that tie, then the shares are merged.
+ *  3. If the whole roster fit in one chunk it goes straight to the output,
+ *     otherwise each chunk becomes a sorted run file and the runs are k-way
+ *     merged with a heap, in several passes if there are very many.
+ *
+ * Order is the same as strcmp on the names. Blank lines and trailing '\r'
+ * are dropped.
+ *
+ *   ./sort_students -i students.txt -o sorted_students.txt -m 512 -t 8
+ */
+
+#define DEFAULT_INPUT "students.txt"
+#define DEFAULT_OUTPUT "sorted_students.txt"
+#define DEFAULT_MEMORY_MB 256
+#define MAX_THREADS 64
+#define MAX_FANIN 128
+#define SMALL_SORT 32
+#define WRITE_BUFFER_LEN (4 * 1024 * 1024)
+#define MIN_READ_BUFFER_LEN (64 * 1024)
+#define PARALLEL_MIN_NAMES 65536
+
+//One name, a slice of the arena plus a sort key
+typedef struct {
+    uint64_t key;            //8 bytes of the name from the current offset, big-endian
+    const char *text;
+    uint32_t len;
+} name_t;
+
+//Buffered output with large write() calls
+typedef struct {
+    int fd;
+    char *buf;
+    size_t len;
+    size_t cap;
+    uint64_t lines;
+} writer_t;
+
+//Sequential reader over one sorted run file
+typedef struct {
+    int fd;
+    char *buf;
+    size_t cap;
+    size_t start;
+    size_t end;
+    int eof;
+    const char *line;
+    uint32_t len;
+    uint64_t key;
+} run_reader_t;
+
+//Work for one sorting thread
+typedef struct {
+    name_t *names;
+    name_t *scratch;
+    size_t count;
+} sort_job_t;
+
+const char *input_path = DEFAULT_INPUT;
+const char *output_path = DEFAULT_OUTPUT;
+const char *temp_dir = NULL;
+size_t memory_budget = (size_t)DEFAULT_MEMORY_MB * 1024 * 1024;
+int thread_count = 0;
+
+void die(const char *what) {
+    perror(what);
+    exit(EXIT_FAILURE);
+}
+
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Keys and comparison
+ */
+static inline uint64_t key_at(const char *text, uint32_t len, uint32_t offset) {
+    uint64_t key = 0;
+    if (offset >= len) return 0;
+    uint32_t n = len - offset < 8 ? len - offset : 8;
+    for (uint32_t i = 0; i < n; i++) {
+        key |= (uint64_t)(unsigned char)text[offset + i] << (56 - 8 * i);
+    }
+    return key;
+}
+
+static inline int compare_text(const char *a, uint32_t alen, const char *b, uint32_t blen) {
+    uint32_t n = alen < blen ? alen : blen;
+    int c = memcmp(a, b, n);
+    if (c) return c;
+    return (alen > blen) - (alen < blen);
+}
+
+//Compares two names whose keys were taken at offset 0
+static inline int compare_names(const name_t *a, const name_t *b) {
+    if (a->key != b->key) return a->key < b->key ? -1 : 1;
+    return compare_text(a->text, a->len, b->text, b->len);
+}
+
+/*
+ * Sorting
+ * LSD radix on the 64-bit key, one byte per pass, skipping bytes that are the
+ * same for every name (common with rosters sharing a prefix). Groups that
+ * still tie are sorted again on the next 8 bytes. Keys are restored to the
+ * offset-0 key on the way out so merges can use them.
+ */
+static void insertion_sort(name_t *names, size_t count, uint32_t offset) {
+    for (size_t i = 1; i < count; i++) {
+        name_t item = names[i];
+        size_t j = i;
+        while (j > 0) {
+            const name_t *prev = &names[j - 1];
+            uint32_t plen = prev->len > offset ? prev->len - offset : 0;
+            uint32_t ilen = item.len > offset ? item.len - offset : 0;
+            if (compare_text(prev->text + offset, plen, item.text + offset, ilen) <= 0) break;
+            names[j] = names[j - 1];
+            j--;
+        }
+        names[j] = item;
+    }
+}
+
+static void sort_range(name_t *names, name_t *scratch, size_t count, uint32_t offset) {
+    if (count < SMALL_SORT) {
+        insertion_sort(names, count, offset);
+        for (size_t i = 0; i < count; i++) names[i].key = key_at(names[i].text, names[i].len, 0);
+        return;
+    }
+
+    if (offset > 0) {
+        for (size_t i = 0; i < count; i++) names[i].key = key_at(names[i].text, names[i].len, offset);
+    }
+
+    //One pass builds the histograms for all 8 key bytes
+    static __thread size_t counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < count; i++) {
+        uint64_t key = names[i].key;
+        for (int b = 0; b < 8; b++) counts[b][(key >> (8 * b)) & 0xff]++;
+    }
+
+    name_t *from = names;
+    name_t *to = scratch;
+    for (int b = 0; b < 8; b++) {
+        size_t *bucket = counts[b];
+        if (bucket[(from[0].key >> (8 * b)) & 0xff] == count) continue;
+
+        size_t position = 0;
+        for (int v = 0; v < 256; v++) {
+            size_t n = bucket[v];
+            bucket[v] = position;
+            position += n;
+        }
+        for (size_t i = 0; i < count; i++) {
+            to[bucket[(from[i].key >> (8 * b)) & 0xff]++] = from[i];
+        }
+        name_t *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != names) memcpy(names, from, count * sizeof(name_t));
+
+    //Break ties on the next 8 bytes
+    size_t i = 0;
+    while (i < count) {
+        size_t j = i + 1;
+        while (j < count && names[j].key == names[i].key) j++;
+
+        int longer = 0;
+        for (size_t k = i; k < j && !longer; k++) longer = names[k].len > offset + 8;
+        if (j - i > 1 && longer) sort_range(names + i, scratch + i, j - i, offset + 8);
+        i = j;
+    }
+
+    if (offset > 0) {
+        for (size_t k = 0; k < count; k++) names[k].key = key_at(names[k].text, names[k].len, 0);
+    }
+}
+
+static void *sort_thread(void *arg) {
+    sort_job_t *job = (sort_job_t *)arg;
+    if (job->count > 0) sort_range(job->names, job->scratch, job->count, 0);
+    return NULL;
+}
+
+/*
+ * Output
+ */
+void writer_init(writer_t *w, int fd) {
+    w->fd = fd;
+    w->cap = WRITE_BUFFER_LEN;
+    w->buf = malloc(w->cap);
+    w->len = 0;
+    w->lines = 0;
+    if (!w->buf) die("Write buffer allocation failed");
+}
+
+void writer_flush(writer_t *w) {
+    size_t done = 0;
+    while (done < w->len) {
+        ssize_t n = write(w->fd, w->buf + done, w->len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            die("Write failed");
+        }
+        done += n;
+    }
+    w->len = 0;
+}
+
+static inline void writer_put(writer_t *w, const char *text, uint32_t len) {
+    if (w->len + len + 1 > w->cap) {
+        writer_flush(w);
+        if (len + 1 > w->cap) {
+            //Name longer than the whole buffer, write it through
+            w->len = 0;
+            size_t done = 0;
+            while (done < len) {
+                ssize_t n = write(w->fd, text + done, len - done);
+                if (n < 0) die("Write failed");
+                done += n;
+            }
+            if (write(w->fd, "\n", 1) != 1) die("Write failed");
+            w->lines++;
+            return;
+        }
+    }
+    memcpy(w->buf + w->len, text, len);
+    w->len += len;
+    w->buf[w->len++] = '\n';
+    w->lines++;
+}
+
+void writer_close(writer_t *w) {
+    writer_flush(w);
+    free(w->buf);
+}
+
+/*
+ * Min-heaps of cursors for the k-way merges
+ */
+typedef int (*cursor_less_t)(void *cursors, int a, int b);
+
+static void heap_down(int *heap, int size, int i, void *cursors, cursor_less_t less) {
+    while (1) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < size && less(cursors, heap[left], heap[smallest])) smallest = left;
+        if (right < size && less(cursors, heap[right], heap[smallest])) smallest = right;
+        if (smallest == i) return;
+        int tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void heap_build(int *heap, int size, void *cursors, cursor_less_t less) {
+    for (int i = size / 2 - 1; i >= 0; i--) heap_down(heap, size, i, cursors, less);
+}
+
+//Cursor over one thread's sorted share of a chunk
+typedef struct {
+    name_t *next;
+    name_t *end;
+} share_cursor_t;
+
+static int share_less(void *cursors, int a, int b) {
+    share_cursor_t *c = (share_cursor_t *)cursors;
+    return compare_names(c[a].next, c[b].next) < 0;
+}
+
+//Sorts one chunk in parallel and writes it out in order
+void sort_and_write(name_t *names, name_t *scratch, size_t count, writer_t *out) {
+    int threads = thread_count;
+    if (count < PARALLEL_MIN_NAMES) threads = 1;
+
+    pthread_t tids[MAX_THREADS];
+    sort_job_t jobs[MAX_THREADS];
+    share_cursor_t cursors[MAX_THREADS];
+    size_t per_thread = (count + threads - 1) / threads;
+
+    for (int t = 0; t < threads; t++) {
+        size_t start = t * per_thread < count ? t * per_thread : count;
+        size_t end = start + per_thread < count ? start + per_thread : count;
+        jobs[t].names = names + start;
+        jobs[t].scratch = scratch + start;
+        jobs[t].count = end - start;
+        if (t == threads - 1 || pthread_create(&tids[t], NULL, sort_thread, &jobs[t]) != 0) {
+            tids[t] = 0;
+            sort_thread(&jobs[t]);
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        if (tids[t]) pthread_join(tids[t], NULL);
+    }
+
+    if (threads == 1) {
+        for (size_t i = 0; i < count; i++) writer_put(out, names[i].text, names[i].len);
+        return;
+    }
+
+    int heap[MAX_THREADS];
+    int size = 0;
+    for (int t = 0; t < threads; t++) {
+        cursors[t].next = jobs[t].names;
+        cursors[t].end = jobs[t].names + jobs[t].count;
+        if (jobs[t].count > 0) heap[size++] = t;
+    }
+    heap_build(heap, size, cursors, share_less);
+
+    while (size > 0) {
+        share_cursor_t *c = &cursors[heap[0]];
+        writer_put(out, c->next->text, c->next->len);
+        if (++c->next == c->end) heap[0] = heap[--size];
+        heap_down(heap, size, 0, cursors, share_less);
+    }
+}
+
+/*
+ * Run files
+ * Runs are plain text, one name per line, unlinked as soon as they are
+ * created so nothing is left behind if the program dies.
+ */
+int create_run(void) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/sort_students.XXXXXX", temp_dir);
+    int fd = mkstemp(path);
+    if (fd < 0) die(path);
+    unlink(path);
+    return fd;
+}
+
+int reader_next(run_reader_t *r) {
+    while (1) {
+        char *newline = memchr(r->buf + r->start, '\n', r->end - r->start);
+        if (newline) {
+            r->line = r->buf + r->start;
+            r->len = newline - r->line;
+            r->key = key_at(r->line, r->len, 0);
+            r->start = newline - r->buf + 1;
+            return 1;
+        }
+        if (r->eof) return 0;
+
+        //Keep the partial line, grow the buffer if a single line fills it
+        size_t left = r->end - r->start;
+        memmove(r->buf, r->buf + r->start, left);
+        r->start = 0;
+        r->end = left;
+        if (r->end == r->cap) {
+            r->cap *= 2;
+            r->buf = realloc(r->buf, r->cap);
+            if (!r->buf) die("Run buffer allocation failed");
+        }
+
+        ssize_t n = read(r->fd, r->buf + r->end, r->cap - r->end);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            die("Run read failed");
+        }
+        if (n == 0) r->eof = 1;
+        r->end += n;
+    }
+}
+
+static int reader_less(void *cursors, int a, int b) {
+    run_reader_t *r = (run_reader_t *)cursors;
+    if (r[a].key != r[b].key) return r[a].key < r[b].key;
+    return compare_text(r[a].line, r[a].len, r[b].line, r[b].len) < 0;
+}
+
+//Merges run files into out, closing them
+void merge_runs(int *runs, int count, writer_t *out, size_t buffer_len) {
+    run_reader_t *readers = calloc(count, sizeof(run_reader_t));
+    int *heap = malloc(count * sizeof(int));
+    if (!readers || !heap) die("Merge allocation failed");
+
+    int size = 0;
+    for (int i = 0; i < count; i++) {
+        readers[i].fd = runs[i];
+        readers[i].cap = buffer_len;
+        readers[i].buf = malloc(buffer_len);
+        if (!readers[i].buf) die("Run buffer allocation failed");
+        if (lseek(runs[i], 0, SEEK_SET) < 0) die("Run seek failed");
+        posix_fadvise(runs[i], 0, 0, POSIX_FADV_SEQUENTIAL);
+        if (reader_next(&readers[i])) heap[size++] = i;
+    }
+    heap_build(heap, size, readers, reader_less);
+
+    while (size > 0) {
+        run_reader_t *r = &readers[heap[0]];
+        writer_put(out, r->line, r->len);
+        if (!reader_next(r)) heap[0] = heap[--size];
+        heap_down(heap, size, 0, readers, reader_less);
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(readers[i].buf);
+        close(readers[i].fd);
+    }
+    free(readers);
+    free(heap);
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-i input] [-o output] [-m memory_mb] [-t threads] [-T temp_dir]\n", prog);
+    fprintf(stderr, "  -i  roster to sort, one name per line (default %s)\n", DEFAULT_INPUT);
+    fprintf(stderr, "  -o  sorted output (default %s)\n", DEFAULT_OUTPUT);
+    fprintf(stderr, "  -m  memory budget in MB (default %d)\n", DEFAULT_MEMORY_MB);
+    fprintf(stderr, "  -t  sorting threads (default: one per CPU)\n");
+    fprintf(stderr, "  -T  directory for run files (default: next to the output)\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "i:o:m:t:T:")) != -1) {
+        switch (opt) {
+        case 'i': input_path = optarg; break;
+        case 'o': output_path = optarg; break;
+        case 'm': memory_budget = (size_t)atol(optarg) * 1024 * 1024; break;
+        case 't': thread_count = atoi(optarg); break;
+        case 'T': temp_dir = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (memory_budget < 4 * 1024 * 1024) {
+        fprintf(stderr, "Memory budget must be at least 4 MB\n");
+        exit(EXIT_FAILURE);
+    }
+    if (thread_count <= 0) thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > MAX_THREADS) thread_count = MAX_THREADS;
+
+    //Run files go next to the output unless told otherwise
+    static char output_dir[4096];
+    if (!temp_dir) {
+        snprintf(output_dir, sizeof(output_dir), "%s", output_path);
+        char *slash = strrchr(output_dir, '/');
+        if (slash) {
+            *slash = '\0';
+            temp_dir = output_dir[0] ? output_dir : "/";
+        } else {
+            temp_dir = ".";
+        }
+    }
+
+    int in_fd = open(input_path, O_RDONLY);
+    if (in_fd < 0) die(input_path);
+    posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    /*
+     * Budget split: half for name text, the rest for slices and the radix
+     * scratch copy (2 x 24 bytes per name). The write buffer is extra.
+     */
+    size_t arena_len = memory_budget / 2;
+    size_t max_names = (memory_budget - arena_len) / (2 * sizeof(name_t));
+    char *arena = malloc(arena_len);
+    name_t *names = malloc(max_names * sizeof(name_t));
+    name_t *scratch = malloc(max_names * sizeof(name_t));
+    if (!arena || !names || !scratch) die("Arena allocation failed");
+
+    double started = now_seconds();
+    int *runs = NULL;
+    int run_count = 0;
+    int run_cap = 0;
+    uint64_t total_names = 0;
+    size_t filled = 0;
+    int done = 0;
+
+    while (!done) {
+        //Slice complete lines out of the arena, reading more as needed
+        size_t scan = 0;
+        size_t count = 0;
+        int eof = 0;
+        while (1) {
+            while (count < max_names) {
+                char *line = arena + scan;
+                char *newline = memchr(line, '\n', filled - scan);
+                if (!newline) break;
+                uint32_t len = newline - line;
+                if (len > 0 && line[len - 1] == '\r') len--;
+                if (len > 0) {
+                    names[count].text = line;
+                    names[count].len = len;
+                    names[count].key = key_at(line, len, 0);
+                    count++;
+                }
+                scan = newline - arena + 1;
+            }
+            if (count == max_names) break;
+
+            if (eof) {
+                //Last name without a trailing newline
+                uint32_t len = filled - scan;
+                if (len > 0 && arena[scan + len - 1] == '\r') len--;
+                if (len > 0) {
+                    names[count].text = arena + scan;
+                    names[count].len = len;
+                    names[count].key = key_at(arena + scan, len, 0);
+                    count++;
+                }
+                scan = filled;
+                break;
+            }
+            if (filled == arena_len) {
+                if (scan == 0) {
+                    fprintf(stderr, "A line in %s is longer than half the memory budget\n", input_path);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+
+            ssize_t n = read(in_fd, arena + filled, arena_len - filled);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                die("Read failed");
+            }
+            if (n == 0) eof = 1;
+            filled += n;
+        }
+
+        total_names += count;
+        done = eof && scan == filled;
+
+        if (done && run_count == 0) {
+            //Everything fit in memory, no run files needed
+            int out_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (out_fd < 0) die(output_path);
+            writer_t out;
+            writer_init(&out, out_fd);
+            sort_and_write(names, scratch, count, &out);
+            writer_close(&out);
+            if (close(out_fd) < 0) die("Close failed");
+        } else if (count > 0) {
+            if (run_count == run_cap) {
+                run_cap = run_cap ? run_cap * 2 : 64;
+                runs = realloc(runs, run_cap * sizeof(int));
+                if (!runs) die("Run table allocation failed");
+            }
+            int run_fd = create_run();
+            writer_t out;
+            writer_init(&out, run_fd);
+            sort_and_write(names, scratch, count, &out);
+            writer_close(&out);
+            runs[run_count++] = run_fd;
+        }
+
+        memmove(arena, arena + scan, filled - scan);
+        filled -= scan;
+    }
+    close(in_fd);
+
+    //The arena is no longer needed, its memory goes to the merge buffers
+    free(arena);
+    free(names);
+    free(scratch);
+
+    if (run_count > 0) {
+        size_t merge_budget = memory_budget - WRITE_BUFFER_LEN;
+        int passes = 0;
+
+        //Too many runs to open at once, merge them in groups first
+        while (run_count > MAX_FANIN) {
+            int merged = 0;
+            for (int i = 0; i < run_count; i += MAX_FANIN) {
+                int group = run_count - i < MAX_FANIN ? run_count - i : MAX_FANIN;
+                int run_fd = create_run();
+                writer_t out;
+                writer_init(&out, run_fd);
+                size_t buffer_len = merge_budget / group;
+                merge_runs(runs + i, group, &out, buffer_len > MIN_READ_BUFFER_LEN ? buffer_len : MIN_READ_BUFFER_LEN);
+                writer_close(&out);
+                runs[merged++] = run_fd;
+            }
+            run_count = merged;
+            passes++;
+        }
+
+        int out_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) die(output_path);
+        writer_t out;
+        writer_init(&out, out_fd);
+        size_t buffer_len = merge_budget / run_count;
+        merge_runs(runs, run_count, &out, buffer_len > MIN_READ_BUFFER_LEN ? buffer_len : MIN_READ_BUFFER_LEN);
+        writer_close(&out);
+        if (close(out_fd) < 0) die("Close failed");
+
+        fprintf(stderr, "Merged %d sorted runs in %d extra passes\n", run_count, passes);
+    }
+    free(runs);
+
+    fprintf(stderr, "Sorted %llu names from %s into %s in %.2fs using %d threads\n",
+            (unsigned long long)total_names, input_path, output_path, now_seconds() - started, thread_count);
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <time.h>
+#include <string.h>
 
 #define MAX_QUEUE_SIZE 8
 #define PREP_TIME 4
@@ -11,6 +12,7 @@
 //Shared data struct for instances
 typedef struct {
     int drinks[MAX_QUEUE_SIZE];
+    struct timespec queued_at[MAX_QUEUE_SIZE];
     int front;
     int rear;
     int count;
@@ -24,6 +26,18 @@ typedef struct {
 
 OrderQueue queue;
 
+/*
+ Benchmark mode (-n items): no sleeps or per-drink logging, the barista makes
+ exactly that many drinks as fast as the queue allows and the waiter records how
+ long each one sat in the queue. 0 keeps the normal 20 second simulation.
+ */
+int bench_items = 0;
+long *bench_latency_ns = NULL;
+
+long elapsed_ns(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * 1000000000L + (to->tv_nsec - from->tv_nsec);
+}
+
 //Shared queue of threads
 void init_queue(OrderQueue *q) {
     q->front = 0;
@@ -39,32 +53,35 @@ void init_queue(OrderQueue *q) {
 
 //Barista thread function
 void* barista_thread(void* arg) {
-    printf("Barista started work! Preparing drinks.\n");
+    if (!bench_items) printf("Barista started work! Preparing drinks.\n");
     
     while (1) {
-        sleep(PREP_TIME);
+        if (!bench_items) sleep(PREP_TIME);
         
         pthread_mutex_lock(&queue.mutex);
         
         //If queue is full then pause
         while (queue.count == MAX_QUEUE_SIZE) {
-            printf("BARISTA PAUSED - Queue full (%d/drinks waiting)\n", queue.count);
+            if (!bench_items) printf("BARISTA PAUSED - Queue full (%d/drinks waiting)\n", queue.count);
             pthread_cond_wait(&queue.not_full, &queue.mutex);
-            printf("BARISTA RESUMED \n");
+            if (!bench_items) printf("BARISTA RESUMED \n");
         }
         
         //Adding drink to queue
         int drink_id = ++queue.total_prepared;
         queue.drinks[queue.rear] = drink_id;
+        if (bench_items) clock_gettime(CLOCK_MONOTONIC, &queue.queued_at[queue.rear]);
         queue.rear = (queue.rear + 1) % MAX_QUEUE_SIZE;
         queue.count++;
         
-        printf("Barista prepared drink #%d | Queue size is: %d/8\n", 
-               drink_id, queue.count);
+        if (!bench_items) printf("Barista prepared drink #%d | Queue size is: %d/8\n", 
+                                 drink_id, queue.count);
         
         //Let it be known queue is not empty
         pthread_cond_signal(&queue.not_empty);
         pthread_mutex_unlock(&queue.mutex);
+        
+        if (bench_items && drink_id == bench_items) break;
     }
     
     return NULL;
@@ -72,30 +89,39 @@ void* barista_thread(void* arg) {
 
 //Waiter thread
 void* waiter_thread(void* arg) {
-    printf("Waiter started work!\n");
+    if (!bench_items) printf("Waiter started work!\n");
     
     while (1) {
         pthread_mutex_lock(&queue.mutex);
         
         // Wait if queue is empty - waiter must wait
         while (queue.count == 0) {
-            printf("WAITER WAITING, no drinks available\n");
+            if (!bench_items) printf("WAITER WAITING, no drinks available\n");
             pthread_cond_wait(&queue.not_empty, &queue.mutex);
-            printf("WAITER IS UP, new drink ready!\n");
+            if (!bench_items) printf("WAITER IS UP, new drink ready!\n");
         }
         
         //Removed drink from queue
         int drink_id = queue.drinks[queue.front];
+        if (bench_items) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            bench_latency_ns[drink_id - 1] = elapsed_ns(&queue.queued_at[queue.front], &now);
+        }
         queue.front = (queue.front + 1) % MAX_QUEUE_SIZE;
         queue.count--;
         queue.total_served++;
         
-        printf("Waiter picked up drink #%d | Queue size: %d/8\n", 
-               drink_id, queue.count);
+        if (!bench_items) printf("Waiter picked up drink #%d | Queue size: %d/8\n", 
+                                 drink_id, queue.count);
         
         pthread_cond_signal(&queue.not_full);
         pthread_mutex_unlock(&queue.mutex);
         
+        if (bench_items) {
+            if (drink_id == bench_items) break;
+            continue;
+        }
         sleep(SERVE_TIME);
         printf("Drink #%d served to customer!\n", drink_id);
     }
@@ -115,9 +141,64 @@ void* monitor_thread(void* arg) {
     return NULL;
 }
 
-int main() {
+int compare_long(const void *a, const void *b) {
+    long x = *(const long *)a;
+    long y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+//Runs the queue flat out and prints key/value results for the benchmark suite
+int run_benchmark(void) {
+    pthread_t barista, waiter;
+    struct timespec start, end;
+    
+    bench_latency_ns = malloc(bench_items * sizeof(long));
+    if (!bench_latency_ns) {
+        perror("Failing to allocate latency table");
+        return 1;
+    }
+    init_queue(&queue);
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (pthread_create(&barista, NULL, barista_thread, NULL) != 0 ||
+        pthread_create(&waiter, NULL, waiter_thread, NULL) != 0) {
+        perror("Failing to create benchmark threads");
+        return 1;
+    }
+    pthread_join(barista, NULL);
+    pthread_join(waiter, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    
+    double seconds = elapsed_ns(&start, &end) / 1e9;
+    qsort(bench_latency_ns, bench_items, sizeof(long), compare_long);
+    printf("items %d\n", bench_items);
+    printf("prepared %d\n", queue.total_prepared);
+    printf("served %d\n", queue.total_served);
+    printf("elapsed_s %.6f\n", seconds);
+    printf("items_per_s %.1f\n", bench_items / seconds);
+    printf("p50_us %.3f\n", bench_latency_ns[bench_items / 2] / 1000.0);
+    printf("p99_us %.3f\n", bench_latency_ns[(long)bench_items * 99 / 100] / 1000.0);
+    printf("max_us %.3f\n", bench_latency_ns[bench_items - 1] / 1000.0);
+    
+    free(bench_latency_ns);
+    pthread_mutex_destroy(&queue.mutex);
+    pthread_cond_destroy(&queue.not_empty);
+    pthread_cond_destroy(&queue.not_full);
+    return queue.total_served == bench_items ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
     pthread_t barista, waiter, monitor;
     
+    if (argc == 3 && strcmp(argv[1], "-n") == 0) {
+        bench_items = atoi(argv[2]);
+        if (bench_items < 1) {
+            fprintf(stderr, "Usage: %s [-n items]\n", argv[0]);
+            return 1;
+        }
+        return run_benchmark();
+    }
+    
     printf("Coffee Shop Simulation Started!\n");
     printf("\n");
     printf("Barista: Prepares 1 drink every %d seconds\n", PREP_TIME);
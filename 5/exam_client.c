@@ -16,6 +16,7 @@ int main() {
     int client_socket;
     struct sockaddr_in server_addr;
     char buffer[BUFFER_SIZE];
+    char pending[BUFFER_SIZE] = "";
     
     //Creating socket
     client_socket = socket(AF_INET, SOCK_STREAM, 0);
@@ -53,27 +54,60 @@ int main() {
         
         send(client_socket, username, strlen(username), 0);
         
-        memset(buffer, 0, BUFFER_SIZE);
-        int bytes_received = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
+        //While all seats are taken the server sends waiting room updates first
+        int bytes_received;
+        while (1) {
+            memset(buffer, 0, BUFFER_SIZE);
+            bytes_received = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
+            
+            if (bytes_received <= 0) {
+                printf("Server disconnected while authenticating man!\n");
+                close(client_socket);
+                exit(EXIT_FAILURE);
+            }
+            
+            buffer[bytes_received] = '\0';
+            if (strncmp(buffer, "WAITING:", 8) != 0) break;
+            
+            char *update = buffer;
+            char *line_end;
+            while (strncmp(update, "WAITING:", 8) == 0 && (line_end = strchr(update, '\n')) != NULL) {
+                printf("%.*s\n", (int)(line_end - update - 8), update + 8);
+                update = line_end + 1;
+            }
+            if (*update) {
+                memmove(buffer, update, strlen(update) + 1);
+                break;
+            }
+        }
         
-        if (bytes_received <= 0) {
-            printf("Server disconnected while authenticating man!\n");
+        //Rejected or timed out by the server
+        if (strncmp(buffer, "Server:", 7) == 0) {
+            printf("%s", buffer);
             close(client_socket);
             exit(EXIT_FAILURE);
         }
         
-        buffer[bytes_received] = '\0';
-        
         char *newline = strchr(buffer, '\n');
         if (newline) *newline = '\0';
         
         if (strcmp(buffer, "AUTH_SUCCESS") == 0) {
             printf("Authentication successful!\n");
             
-            // Receive welcome message
-            memset(buffer, 0, BUFFER_SIZE);
-            recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
-            printf("%s", buffer);
+            // Receive welcome message, after a wait for a seat it is already here
+            char *rest = newline ? newline + 1 : buffer + bytes_received;
+            if (*rest == '\0') {
+                memset(buffer, 0, BUFFER_SIZE);
+                recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
+                rest = buffer;
+            }
+            char *welcome_end = strchr(rest, '\n');
+            if (welcome_end) {
+                printf("%.*s", (int)(welcome_end - rest + 1), rest);
+                strcpy(pending, welcome_end + 1);
+            } else {
+                printf("%s", rest);
+            }
             break;
         } else {
             printf("Authentication failed. Please try again with a different username.\n");
@@ -82,27 +116,42 @@ int main() {
     
     // Exam phase
     while (1) {
-        memset(buffer, 0, BUFFER_SIZE);
-        int bytes_received = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
-        
-        if (bytes_received <= 0) {
-            printf("Server disconnected\n");
-            break;
+        //Anything that arrived together with the welcome message goes first
+        if (pending[0]) {
+            strcpy(buffer, pending);
+            pending[0] = '\0';
+        } else {
+            memset(buffer, 0, BUFFER_SIZE);
+            int bytes_received = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
+            
+            if (bytes_received <= 0) {
+                printf("Server disconnected\n");
+                break;
+            }
+            
+            buffer[bytes_received] = '\0';
         }
         
-        buffer[bytes_received] = '\0';
+        //Feedback and notices can share a read with the next question, print them first
+        char *end_msg = strstr(buffer, "EXAM_END");
+        char *question_msg = strstr(buffer, "QUESTION");
+        char *next_msg = question_msg;
+        if (end_msg && (!question_msg || end_msg < question_msg)) next_msg = end_msg;
+        if (next_msg != buffer) {
+            printf("%.*s", (int)(next_msg ? next_msg - buffer : (long)strlen(buffer)), buffer);
+        }
         
         // Check for exam end message
-        if (strstr(buffer, "EXAM_END") != NULL) {
-            char *end_msg = strstr(buffer, "Thank you");
-            if (end_msg) {
-                printf("\n%s", end_msg);
+        if (end_msg && next_msg == end_msg) {
+            char *thank_you = strstr(end_msg, "Thank you");
+            if (thank_you) {
+                printf("\n%s", thank_you);
             }
             break;
         }
         
-        if (strstr(buffer, "QUESTION") != NULL) {
-            char *question = strchr(buffer, ':');
+        if (question_msg) {
+            char *question = strchr(question_msg, ':');
             if (question) {
                 printf("%s\n", question + 1);
             }
@@ -116,19 +165,8 @@ int main() {
                 break;
             }
             
+            //Feedback and the active users list come back through the loop
             send(client_socket, answer, strlen(answer), 0);
-            
-            memset(buffer, 0, BUFFER_SIZE);
-            recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
-            printf("%s", buffer);
-            
-            memset(buffer, 0, BUFFER_SIZE);
-            recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
-            printf("%s\n", buffer);
-        } 
-        //Handles notifications of Students/Users
-        else if (strstr(buffer, "Student") != NULL || strstr(buffer, "Active users") != NULL) {
-            printf("%s", buffer);
         }
     }
     
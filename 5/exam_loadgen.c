@@ -0,0 +1,666 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+/*
+ * Headless load generator for exam_server.
+ * Runs many scripted students from one process on a single epoll loop:
+ * connect, send a username, answer every question after a think time and
+ * wait for EXAM_END. Connect, auth and per-question round-trip latencies go
+ * into histograms that are written to a results file at the end, so two
+ * server builds can be compared on localhost.
+ *
+ *   ./exam_loadgen -n 5000 -c 1000 -t 50 -o results.txt
+ *
+ * Every step that waits on the server (connect, auth, the next question or
+ * reply) has a deadline, -T. A session that misses it is counted as failed
+ * and its slot reused, so a server that never accepts can't stall the run.
+ * Sessions in the server's waiting room are exempt, the server bounds that.
+ */
+
+#define BUFFER_SIZE 4096
+#define MAX_USERNAME_LEN 48
+#define MAX_EVENTS 256
+
+//Log-linear histogram: 16 sub-buckets per power of two, values in microseconds
+#define HIST_SUB_BITS 4
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (64 * HIST_SUB_COUNT)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+} histogram_t;
+
+typedef enum {
+    CONN_IDLE,
+    CONN_CONNECTING,
+    CONN_AUTH_SENT,
+    CONN_IN_EXAM,
+    CONN_THINKING,
+    CONN_ANSWER_SENT
+} conn_state_t;
+
+//One scripted student
+typedef struct {
+    int fd;
+    conn_state_t state;
+    unsigned generation;     //Bumped on every new session, stale timers are skipped
+    uint32_t rng;
+    char username[MAX_USERNAME_LEN];
+    char inbuf[BUFFER_SIZE];
+    size_t inlen;
+    uint64_t connect_start;
+    uint64_t auth_sent;
+    uint64_t answer_sent;
+    uint64_t reply_deadline; //0 while nothing is expected from the server
+    int reply_timer;         //A TIMER_REPLY entry for this session is in the heap
+    int answers;
+    int queued;
+} conn_t;
+
+typedef enum {
+    TIMER_THINK,             //Send the next answer
+    TIMER_REPLY              //Check the session's reply_deadline
+} timer_kind_t;
+
+//Pending wakeup, kept in a min-heap on deadline
+typedef struct {
+    uint64_t deadline;
+    int conn;
+    unsigned generation;
+    timer_kind_t kind;
+} think_timer_t;
+
+typedef struct {
+    think_timer_t *items;
+    int count;
+    int capacity;
+} timer_heap_t;
+
+//Run settings
+const char *server_host = "127.0.0.1";
+int server_port = 8080;
+int total_sessions = 100;
+int concurrency = 100;
+int think_ms = 0;
+int jitter_ms = 0;
+int connect_rate = 0;
+int reply_timeout_ms = 30000;
+char fixed_answer = 0;
+const char *user_prefix = "load";
+const char *results_path = "loadgen_results.txt";
+
+//Run state
+conn_t *conns;
+int *idle_slots;         //Stack of connection slots ready for a new session
+int idle_count = 0;
+timer_heap_t timers;
+int epoll_fd;
+struct sockaddr_in server_addr;
+int sessions_started = 0;
+int sessions_completed = 0;
+int sessions_failed = 0;
+int sessions_rejected = 0;
+int sessions_queued = 0;
+int sessions_timed_out = 0;
+int auth_failures = 0;
+uint64_t questions_answered = 0;
+uint64_t answers_correct = 0;
+
+histogram_t connect_hist;
+histogram_t auth_hist;
+histogram_t question_hist;
+histogram_t session_hist;
+
+uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/*
+ * Histogram helpers
+ * Values below 16us get exact buckets, above that each power of two is split
+ * into 16 linear sub-buckets, which keeps the error under about 6%.
+ */
+int hist_index(uint64_t value) {
+    if (value < HIST_SUB_COUNT) return (int)value;
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - HIST_SUB_BITS;
+    int sub = (int)((value >> shift) & (HIST_SUB_COUNT - 1));
+    return (shift + 1) * HIST_SUB_COUNT + sub;
+}
+
+//Largest value that still lands in bucket index
+uint64_t hist_upper(int index) {
+    if (index < HIST_SUB_COUNT) return index;
+    int shift = index / HIST_SUB_COUNT - 1;
+    uint64_t sub = index % HIST_SUB_COUNT;
+    return ((HIST_SUB_COUNT + sub + 1) << shift) - 1;
+}
+
+void hist_record(histogram_t *h, uint64_t value) {
+    h->counts[hist_index(value)]++;
+    if (h->count == 0 || value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+    h->count++;
+    h->sum += value;
+}
+
+uint64_t hist_percentile(const histogram_t *h, double percentile) {
+    if (h->count == 0) return 0;
+    uint64_t target = (uint64_t)(percentile / 100.0 * h->count + 0.5);
+    if (target < 1) target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= target) {
+            uint64_t upper = hist_upper(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+void hist_write(FILE *out, const char *name, const histogram_t *h) {
+    fprintf(out, "%s count=%llu min=%llu mean=%llu p50=%llu p90=%llu p99=%llu p999=%llu max=%llu\n",
+            name, (unsigned long long)h->count, (unsigned long long)h->min,
+            (unsigned long long)(h->count ? h->sum / h->count : 0),
+            (unsigned long long)hist_percentile(h, 50.0),
+            (unsigned long long)hist_percentile(h, 90.0),
+            (unsigned long long)hist_percentile(h, 99.0),
+            (unsigned long long)hist_percentile(h, 99.9),
+            (unsigned long long)h->max);
+}
+
+//Raw buckets so runs can be merged or re-analysed later
+void hist_write_buckets(FILE *out, const char *name, const histogram_t *h) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        if (h->counts[i]) {
+            fprintf(out, "bucket %s %llu %llu\n", name,
+                    (unsigned long long)hist_upper(i), (unsigned long long)h->counts[i]);
+        }
+    }
+}
+
+/*
+ * Timer heap
+ */
+void timer_push(uint64_t deadline, int conn, unsigned generation, timer_kind_t kind) {
+    if (timers.count == timers.capacity) {
+        timers.capacity = timers.capacity ? timers.capacity * 2 : 1024;
+        timers.items = realloc(timers.items, timers.capacity * sizeof(think_timer_t));
+        if (!timers.items) {
+            perror("Timer allocation failed");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    int i = timers.count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (timers.items[parent].deadline <= deadline) break;
+        timers.items[i] = timers.items[parent];
+        i = parent;
+    }
+    timers.items[i].deadline = deadline;
+    timers.items[i].conn = conn;
+    timers.items[i].generation = generation;
+    timers.items[i].kind = kind;
+}
+
+think_timer_t timer_pop(void) {
+    think_timer_t top = timers.items[0];
+    think_timer_t last = timers.items[--timers.count];
+
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= timers.count) break;
+        if (child + 1 < timers.count && timers.items[child + 1].deadline < timers.items[child].deadline) {
+            child++;
+        }
+        if (last.deadline <= timers.items[child].deadline) break;
+        timers.items[i] = timers.items[child];
+        i = child;
+    }
+    if (timers.count > 0) timers.items[i] = last;
+    return top;
+}
+
+/*
+ * Session flow
+ */
+void close_conn(conn_t *c) {
+    if (c->fd >= 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+    }
+    c->fd = -1;
+    c->state = CONN_IDLE;
+    c->inlen = 0;
+    idle_slots[idle_count++] = (int)(c - conns);
+}
+
+//Starts or moves the deadline for the server's next message. A session keeps at
+//most one reply timer in the heap, a timer that fires early just re-arms.
+void expect_reply(int index) {
+    conn_t *c = &conns[index];
+    if (reply_timeout_ms <= 0) return;
+    c->reply_deadline = now_us() + (uint64_t)reply_timeout_ms * 1000;
+    if (!c->reply_timer) {
+        timer_push(c->reply_deadline, index, c->generation, TIMER_REPLY);
+        c->reply_timer = 1;
+    }
+}
+
+void on_reply_timer(int index) {
+    conn_t *c = &conns[index];
+    c->reply_timer = 0;
+    if (c->fd < 0 || c->reply_deadline == 0) return;
+
+    if (c->reply_deadline <= now_us()) {
+        sessions_failed++;
+        close_conn(c);
+        return;
+    }
+    timer_push(c->reply_deadline, index, c->generation, TIMER_REPLY);
+    c->reply_timer = 1;
+}
+
+int send_all(conn_t *c, const char *data, size_t len) {
+    //Messages are a few bytes, the socket buffer always has room for them
+    ssize_t sent = send(c->fd, data, len, MSG_NOSIGNAL);
+    return sent == (ssize_t)len ? 0 : -1;
+}
+
+void start_session(int index) {
+    conn_t *c = &conns[index];
+    c->generation++;
+    c->answers = 0;
+    c->queued = 0;
+    c->inlen = 0;
+    c->reply_deadline = 0;
+    c->reply_timer = 0;
+    c->rng = 2463534242u ^ (uint32_t)(sessions_started * 2654435761u);
+    snprintf(c->username, MAX_USERNAME_LEN, "%s%d", user_prefix, sessions_started);
+    sessions_started++;
+
+    c->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (c->fd < 0) {
+        perror("Socket creation failed");
+        sessions_failed++;
+        close_conn(c);
+        return;
+    }
+
+    int opt = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    c->connect_start = now_us();
+    c->state = CONN_CONNECTING;
+    int rc = connect(c->fd, (struct sockaddr *)&server_addr, sizeof(server_addr));
+    if (rc < 0 && errno != EINPROGRESS) {
+        perror("Connection failed");
+        sessions_failed++;
+        close_conn(c);
+        return;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+    ev.data.u32 = index;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->fd, &ev);
+    expect_reply(index);
+}
+
+//Connect finished, send the username
+void on_connected(int index) {
+    conn_t *c = &conns[index];
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err) {
+        sessions_failed++;
+        close_conn(c);
+        return;
+    }
+
+    uint64_t now = now_us();
+    hist_record(&connect_hist, now - c->connect_start);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u32 = index;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+
+    c->auth_sent = now;
+    c->state = CONN_AUTH_SENT;
+    if (send_all(c, c->username, strlen(c->username)) < 0) {
+        sessions_failed++;
+        close_conn(c);
+        return;
+    }
+    expect_reply(index);
+}
+
+void send_answer(int index) {
+    conn_t *c = &conns[index];
+    char answer[3] = { fixed_answer, '\n', '\0' };
+    if (!fixed_answer) answer[0] = 'A' + next_random(&c->rng) % 4;
+
+    c->answer_sent = now_us();
+    c->state = CONN_ANSWER_SENT;
+    if (send_all(c, answer, 2) < 0) {
+        sessions_failed++;
+        close_conn(c);
+        return;
+    }
+    expect_reply(index);
+}
+
+void on_question(int index) {
+    conn_t *c = &conns[index];
+    int delay = think_ms;
+    if (jitter_ms > 0) delay += (int)(next_random(&c->rng) % (2 * jitter_ms + 1)) - jitter_ms;
+
+    if (delay <= 0) {
+        send_answer(index);
+        return;
+    }
+    c->state = CONN_THINKING;
+    c->reply_deadline = 0;
+    timer_push(now_us() + (uint64_t)delay * 1000, index, c->generation, TIMER_THINK);
+}
+
+//Handles one complete line from the server. Returns 0 once the session is over.
+int on_line(int index, const char *line) {
+    conn_t *c = &conns[index];
+    uint64_t now = now_us();
+
+    if (strncmp(line, "AUTH_SUCCESS", 12) == 0) {
+        hist_record(&auth_hist, now - c->auth_sent);
+        c->state = CONN_IN_EXAM;
+    } else if (strncmp(line, "AUTH_FAILED", 11) == 0) {
+        //Username clash, make it unique and go again
+        auth_failures++;
+        size_t len = strlen(c->username);
+        if (len + 2 < MAX_USERNAME_LEN) {
+            c->username[len] = 'x';
+            c->username[len + 1] = '\0';
+        }
+        c->auth_sent = now;
+        if (send_all(c, c->username, strlen(c->username)) < 0) {
+            sessions_failed++;
+            close_conn(c);
+            return 0;
+        }
+    } else if (strncmp(line, "QUESTION_", 9) == 0) {
+        if (c->state == CONN_IN_EXAM) on_question(index);
+    } else if (strncmp(line, "Server/Teacher:", 15) == 0) {
+        if (c->state == CONN_ANSWER_SENT) {
+            hist_record(&question_hist, now - c->answer_sent);
+            questions_answered++;
+            if (strstr(line, "Correct!")) answers_correct++;
+            c->answers++;
+            c->state = CONN_IN_EXAM;
+        }
+    } else if (strncmp(line, "EXAM_END", 8) == 0) {
+        hist_record(&session_hist, (now - c->connect_start) / 1000);
+        sessions_completed++;
+        close_conn(c);
+        return 0;
+    } else if (strncmp(line, "WAITING:", 8) == 0) {
+        //Sitting in the server's waiting room, auth latency includes the wait.
+        //The server's own -W bounds the wait, so no reply deadline meanwhile.
+        if (!c->queued) sessions_queued++;
+        c->queued = 1;
+        c->reply_deadline = 0;
+        return 1;
+    } else if (strncmp(line, "Server: Max student limit", 25) == 0) {
+        sessions_rejected++;
+        close_conn(c);
+        return 0;
+    } else if (strstr(line, "timed out") || strstr(line, "Waited too long")) {
+        sessions_timed_out++;
+        close_conn(c);
+        return 0;
+    }
+
+    //A failed send above closed the session, later buffered lines are stale
+    if (c->fd < 0) return 0;
+    if (c->state != CONN_THINKING) expect_reply(index);
+    return 1;
+}
+
+void on_readable(int index) {
+    conn_t *c = &conns[index];
+
+    while (c->fd >= 0) {
+        ssize_t n = recv(c->fd, c->inbuf + c->inlen, BUFFER_SIZE - c->inlen, 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR) continue;
+            sessions_failed++;
+            close_conn(c);
+            return;
+        }
+        if (n == 0) {
+            //Server hung up before EXAM_END
+            sessions_failed++;
+            close_conn(c);
+            return;
+        }
+        c->inlen += n;
+
+        //Process every complete line, keep the tail for the next read
+        char *start = c->inbuf;
+        char *end = c->inbuf + c->inlen;
+        char *newline;
+        while ((newline = memchr(start, '\n', end - start)) != NULL) {
+            *newline = '\0';
+            if (!on_line(index, start)) return;
+            start = newline + 1;
+        }
+
+        size_t left = end - start;
+        if (left == BUFFER_SIZE) left = 0; //Line longer than the buffer, drop it
+        memmove(c->inbuf, start, left);
+        c->inlen = left;
+    }
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  -h host     server address (default 127.0.0.1)\n");
+    fprintf(stderr, "  -p port     server port (default 8080)\n");
+    fprintf(stderr, "  -n count    total exam sessions to run (default 100)\n");
+    fprintf(stderr, "  -c count    sessions open at the same time (default 100)\n");
+    fprintf(stderr, "  -t ms       think time before each answer (default 0)\n");
+    fprintf(stderr, "  -j ms       random +/- jitter on the think time (default 0)\n");
+    fprintf(stderr, "  -r rate     max new connections per second, 0 = no limit\n");
+    fprintf(stderr, "  -T seconds  longest wait for the server at any step, 0 = no limit (default 30)\n");
+    fprintf(stderr, "  -a letter   always answer this letter instead of a random one\n");
+    fprintf(stderr, "  -u prefix   username prefix (default \"load\")\n");
+    fprintf(stderr, "  -o file     results file (default loadgen_results.txt)\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "h:p:n:c:t:j:r:T:a:u:o:")) != -1) {
+        switch (opt) {
+        case 'h': server_host = optarg; break;
+        case 'p': server_port = atoi(optarg); break;
+        case 'n': total_sessions = atoi(optarg); break;
+        case 'c': concurrency = atoi(optarg); break;
+        case 't': think_ms = atoi(optarg); break;
+        case 'j': jitter_ms = atoi(optarg); break;
+        case 'r': connect_rate = atoi(optarg); break;
+        case 'T': reply_timeout_ms = atoi(optarg) * 1000; break;
+        case 'a': fixed_answer = optarg[0]; break;
+        case 'u': user_prefix = optarg; break;
+        case 'o': results_path = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (total_sessions < 1 || concurrency < 1) usage(argv[0]);
+    if (concurrency > total_sessions) concurrency = total_sessions;
+
+    //Thousands of sockets need more than the default descriptor limit
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(server_port);
+    if (inet_pton(AF_INET, server_host, &server_addr.sin_addr) != 1) {
+        fprintf(stderr, "Bad server address %s\n", server_host);
+        exit(EXIT_FAILURE);
+    }
+
+    epoll_fd = epoll_create1(0);
+    conns = calloc(concurrency, sizeof(conn_t));
+    idle_slots = malloc(concurrency * sizeof(int));
+    if (epoll_fd < 0 || !conns || !idle_slots) {
+        perror("Setup failed");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = concurrency - 1; i >= 0; i--) {
+        conns[i].fd = -1;
+        conns[i].state = CONN_IDLE;
+        idle_slots[idle_count++] = i;
+    }
+
+    printf("Running %d sessions against %s:%d, %d at a time, think time %dms\n",
+           total_sessions, server_host, server_port, concurrency, think_ms);
+
+    struct epoll_event events[MAX_EVENTS];
+    uint64_t run_start = now_us();
+
+    while (1) {
+        uint64_t now = now_us();
+
+        //Refill idle slots, respecting the connection rate
+        while (idle_count > 0 && sessions_started < total_sessions) {
+            if (connect_rate > 0 &&
+                sessions_started >= (int)((now - run_start) * connect_rate / 1000000) + 1) {
+                break;
+            }
+            start_session(idle_slots[--idle_count]);
+        }
+        if (idle_count == concurrency && sessions_started >= total_sessions) break;
+
+        //Sleep until the next think timer or rate tick
+        int timeout = -1;
+        if (timers.count > 0) {
+            uint64_t deadline = timers.items[0].deadline;
+            timeout = deadline > now ? (int)((deadline - now + 999) / 1000) : 0;
+        }
+        if (connect_rate > 0 && sessions_started < total_sessions && (timeout < 0 || timeout > 10)) {
+            timeout = 10;
+        }
+
+        int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+        if (ready < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int e = 0; e < ready; e++) {
+            int index = events[e].data.u32;
+            conn_t *c = &conns[index];
+            if (c->fd < 0) continue;
+
+            if (c->state == CONN_CONNECTING) {
+                if (events[e].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) on_connected(index);
+                if (c->fd < 0) continue;
+            }
+            if (events[e].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) on_readable(index);
+        }
+
+        //Fire due think timers and reply deadlines
+        now = now_us();
+        while (timers.count > 0 && timers.items[0].deadline <= now) {
+            think_timer_t t = timer_pop();
+            conn_t *c = &conns[t.conn];
+            if (c->generation != t.generation) continue;
+            if (t.kind == TIMER_REPLY) on_reply_timer(t.conn);
+            else if (c->state == CONN_THINKING) send_answer(t.conn);
+        }
+    }
+
+    double elapsed = (now_us() - run_start) / 1000000.0;
+    double rate = elapsed > 0 ? sessions_completed / elapsed : 0;
+
+    FILE *out = fopen(results_path, "w");
+    if (!out) {
+        perror(results_path);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(out, "# exam_loadgen results, latencies in microseconds, session time in milliseconds\n");
+    fprintf(out, "server %s:%d\n", server_host, server_port);
+    fprintf(out, "concurrency %d\n", concurrency);
+    fprintf(out, "think_ms %d\n", think_ms);
+    fprintf(out, "sessions_started %d\n", sessions_started);
+    fprintf(out, "sessions_completed %d\n", sessions_completed);
+    fprintf(out, "sessions_failed %d\n", sessions_failed);
+    fprintf(out, "sessions_rejected %d\n", sessions_rejected);
+    fprintf(out, "sessions_queued %d\n", sessions_queued);
+    fprintf(out, "sessions_timed_out %d\n", sessions_timed_out);
+    fprintf(out, "auth_failures %d\n", auth_failures);
+    fprintf(out, "questions_answered %llu\n", (unsigned long long)questions_answered);
+    fprintf(out, "answers_correct %llu\n", (unsigned long long)answers_correct);
+    fprintf(out, "elapsed_s %.3f\n", elapsed);
+    fprintf(out, "sessions_per_s %.2f\n", rate);
+    hist_write(out, "connect_us", &connect_hist);
+    hist_write(out, "auth_us", &auth_hist);
+    hist_write(out, "question_rtt_us", &question_hist);
+    hist_write(out, "session_ms", &session_hist);
+    hist_write_buckets(out, "connect_us", &connect_hist);
+    hist_write_buckets(out, "auth_us", &auth_hist);
+    hist_write_buckets(out, "question_rtt_us", &question_hist);
+    hist_write_buckets(out, "session_ms", &session_hist);
+    fclose(out);
+
+    printf("Completed %d/%d sessions in %.2fs (%.2f sessions/s), %d failed, %d rejected, "
+           "%d queued, %d timed out\n", sessions_completed, total_sessions, elapsed, rate,
+           sessions_failed, sessions_rejected, sessions_queued, sessions_timed_out);
+    hist_write(stdout, "connect_us", &connect_hist);
+    hist_write(stdout, "auth_us", &auth_hist);
+    hist_write(stdout, "question_rtt_us", &question_hist);
+    printf("Results written to %s\n", results_path);
+
+    close(epoll_fd);
+    free(timers.items);
+    free(idle_slots);
+    free(conns);
+    return sessions_failed > 0 ? 1 : 0;
+}
@@ -4,13 +4,57 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <pthread.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <semaphore.h>
+#include <time.h>
 #include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/sockios.h>
 
 #define MAX_CLIENTS 4
 #define BUFFER_SIZE 1024
 #define MAX_USERNAME_LEN 50
 #define MAX_QUESTION_LEN 256
+#define MAX_HEADER_LEN 24
+#define MAX_FEEDBACK_LEN 64
+#define DEFAULT_BACKLOG 128
+#define DEFAULT_WAITING_ROOM 16
+#define DEFAULT_IDLE_TIMEOUT 120
+#define DEFAULT_WAIT_TIMEOUT 300
+#define DEFAULT_MAX_OUTQ (64 * 1024)
+#define TIMER_TICK_MS 100
+#define TIMER_WHEEL_SLOTS 1024
+#define THREAD_STACK_SIZE (256 * 1024)
+#define DEFAULT_JOURNAL_PATH "exam_results.journal"
+#define JOURNAL_LINE_LEN 192
+#define JOURNAL_BATCH_LEN (64 * 1024)
+#define JOURNAL_WRITE_RETRIES 3
+#define JOURNAL_RETRY_MS 100
+#define UNFINISHED_BUCKETS 4096
+#define METRIC_BUCKETS 28
+#define DEFAULT_ADMIN_PORT 9090
+#define ADMIN_RESPONSE_LEN (32 * 1024)
+
+//Read/idle deadline of one connection, lives in a slot of the timer wheel
+typedef struct deadline {
+    struct deadline *prev;
+    struct deadline *next;
+    uint64_t expires;        //Wheel tick the deadline fires on
+    int fd;
+    int armed;
+    int fired;
+    int waiter;              //Waiting room entry, -1 for an exam session
+} deadline_t;
 
 //Basic user "client" info struct
 typedef struct {
@@ -19,10 +63,46 @@ typedef struct {
     int active;
     char username[MAX_USERNAME_LEN];
     int authenticated;
+    int slow;                //Dropped for not reading its output
+    deadline_t deadline;
 } client_t;
 
-client_t clients[MAX_CLIENTS];
+//Connection parked until an exam slot frees up
+typedef struct {
+    int fd;
+    struct sockaddr_in address;
+    int queued;
+    int prev;
+    int next;
+    deadline_t deadline;
+} waiter_t;
+
+client_t *clients;
+int *client_indices;
 pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_attr_t session_attr;
+
+//Admission settings
+int max_clients = MAX_CLIENTS;
+int listen_backlog = DEFAULT_BACKLOG;
+int waiting_room_size = DEFAULT_WAITING_ROOM;
+int idle_timeout_s = DEFAULT_IDLE_TIMEOUT;
+int wait_timeout_s = DEFAULT_WAIT_TIMEOUT;
+int max_outq_bytes = DEFAULT_MAX_OUTQ;
+
+//Waiting room, a FIFO list over a fixed pool, guarded by clients_mutex
+waiter_t *waiters;
+int wait_head = -1;
+int wait_tail = -1;
+int wait_free = -1;
+int waiting_count = 0;
+int active_sessions = 0;
+
+//Timer wheel, one bucket per tick, guarded by timer_mutex
+deadline_t *timer_wheel[TIMER_WHEEL_SLOTS];
+uint64_t timer_tick = 0;
+struct timespec timer_epoch;
+pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 //Exam questions struct
 typedef struct {
@@ -37,52 +117,1386 @@ exam_question_t exam_questions[] = {
     {"Tmother of all programming languages?\nA) C\nB) CofeeScript\nC) PythonC\nD) Assembly\n", 'A'}
 };
 
-int total_questions = sizeof(exam_questions) / sizeof(exam_question_t);
+int builtin_questions = sizeof(exam_questions) / sizeof(exam_question_t);
+
+/*
+ * Question bank
+ * A bank file is mmapped once and every question body is sent straight out of
+ * the mapping, so nothing is reformatted or copied per client. The
+ * "QUESTION_n:" prefixes and the "Incorrect!" feedback lines are encoded once
+ * per bank at load time. Bank file format:
+ *
+ *   # comment
+ *   Q B
+ *   Capital of France?
+ *   A) London
+ *   B) Paris
+ *   .
+ *
+ * "Q <letter>" opens a question with its correct answer, a line holding only
+ * "." closes it. To replace a bank on a running server, write the new file
+ * next to the old one, rename() it over and send SIGHUP. Never edit a bank in
+ * place, sessions may still be reading the old mapping.
+ */
+
+//Piece of ready-to-send wire data, points into bank memory
+typedef struct {
+    const char *data;
+    size_t len;
+} frame_t;
+
+typedef struct {
+    frame_t text;            //Question body, slice of the bank file
+    frame_t wrong_feedback;  //"Incorrect! The correct answer was X"
+    char correct_answer;
+} bank_question_t;
+
+typedef struct {
+    char *base;              //Mapped file, or heap copy for the built-in bank
+    size_t size;
+    int mapped;
+    bank_question_t *questions;
+    int count;
+    frame_t *headers;        //headers[i] is the "QUESTION_<i+1>:" prefix
+    char *arena;             //Backing store for headers and feedback frames
+    unsigned generation;
+    atomic_int refs;         //One for being current, one per session using it
+} question_bank_t;
+
+static const frame_t correct_feedback = {
+    "Server/Teacher: Correct!\n", sizeof("Server/Teacher: Correct!\n") - 1
+};
+
+question_bank_t *current_bank = NULL;
+pthread_mutex_t bank_mutex = PTHREAD_MUTEX_INITIALIZER;
+const char *bank_path = NULL;
+int shuffle_questions = 1;
+int server_port = 8080;
+int question_pace_ms = 1000;  //Pause after each answer, 0 for load tests
+
+static void free_bank(question_bank_t *bank) {
+    if (bank->mapped) {
+        munmap(bank->base, bank->size);
+    } else {
+        free(bank->base);
+    }
+    free(bank->questions);
+    free(bank->headers);
+    free(bank->arena);
+    free(bank);
+}
+
+//Splits the bank text into questions. Bodies stay where they are in memory.
+static int parse_bank(question_bank_t *bank, const char *name) {
+    const char *p = bank->base;
+    const char *end = bank->base + bank->size;
+    int capacity = 0;
+    int line_no = 0;
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        const char *next = eol ? eol + 1 : end;
+        line_no++;
+
+        if (*p == '#' || *p == '\n' || *p == '\r') {
+            p = next;
+            continue;
+        }
+
+        if (p[0] != 'Q' || next - p < 3 || p[1] != ' ' || p[2] < 'A' || p[2] > 'Z') {
+            fprintf(stderr, "%s:%d: expected \"Q <answer letter>\"\n", name, line_no);
+            return -1;
+        }
+        char answer = p[2];
+        int start_line = line_no;
+
+        //Body runs until a line holding only "."
+        const char *body = next;
+        const char *body_end = NULL;
+        p = next;
+        while (p < end) {
+            eol = memchr(p, '\n', end - p);
+            next = eol ? eol + 1 : end;
+            line_no++;
+            if (p[0] == '.' && (p + 1 == next || p[1] == '\n' || p[1] == '\r')) {
+                body_end = p;
+                p = next;
+                break;
+            }
+            p = next;
+        }
+
+        if (!body_end || body_end == body) {
+            fprintf(stderr, "%s:%d: question has no body or no closing \".\"\n", name, start_line);
+            return -1;
+        }
+
+        if (bank->count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            bank_question_t *grown = realloc(bank->questions, capacity * sizeof(bank_question_t));
+            if (!grown) return -1;
+            bank->questions = grown;
+        }
+
+        bank_question_t *q = &bank->questions[bank->count++];
+        q->text.data = body;
+        q->text.len = body_end - body;
+        q->correct_answer = answer;
+    }
+
+    if (bank->count == 0) {
+        fprintf(stderr, "%s: no questions found\n", name);
+        return -1;
+    }
+
+    //Encode the per-position prefixes and feedback lines once for the bank
+    bank->headers = malloc(bank->count * sizeof(frame_t));
+    bank->arena = malloc((size_t)bank->count * (MAX_HEADER_LEN + MAX_FEEDBACK_LEN));
+    if (!bank->headers || !bank->arena) return -1;
+
+    char *out = bank->arena;
+    for (int i = 0; i < bank->count; i++) {
+        int len = snprintf(out, MAX_HEADER_LEN, "QUESTION_%d:", i + 1);
+        bank->headers[i].data = out;
+        bank->headers[i].len = len;
+        out += MAX_HEADER_LEN;
+
+        len = snprintf(out, MAX_FEEDBACK_LEN, "Server/Teacher: Incorrect! The correct answer was %c\n",
+                       bank->questions[i].correct_answer);
+        bank->questions[i].wrong_feedback.data = out;
+        bank->questions[i].wrong_feedback.len = len;
+        out += MAX_FEEDBACK_LEN;
+    }
+
+    return 0;
+}
+
+question_bank_t *load_bank_file(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        fprintf(stderr, "%s: empty or unreadable bank\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    madvise(base, st.st_size, MADV_WILLNEED);
+
+    question_bank_t *bank = calloc(1, sizeof(question_bank_t));
+    if (!bank) {
+        munmap(base, st.st_size);
+        return NULL;
+    }
+    bank->base = base;
+    bank->size = st.st_size;
+    bank->mapped = 1;
+
+    if (parse_bank(bank, path) < 0) {
+        free_bank(bank);
+        return NULL;
+    }
+    return bank;
+}
+
+//Fallback when no bank file is given: encode exam_questions[] in bank format
+question_bank_t *load_builtin_bank(void) {
+    size_t capacity = builtin_questions * (MAX_QUESTION_LEN + 8);
+    question_bank_t *bank = calloc(1, sizeof(question_bank_t));
+    if (!bank) return NULL;
+    bank->base = malloc(capacity);
+    if (!bank->base) {
+        free(bank);
+        return NULL;
+    }
+
+    size_t used = 0;
+    for (int i = 0; i < builtin_questions; i++) {
+        used += snprintf(bank->base + used, capacity - used, "Q %c\n%s.\n",
+                         exam_questions[i].correct_answer, exam_questions[i].question);
+    }
+    bank->size = used;
+
+    if (parse_bank(bank, "built-in questions") < 0) {
+        free_bank(bank);
+        return NULL;
+    }
+    return bank;
+}
+
+//Takes a reference on the current bank, held for a whole exam session
+question_bank_t *bank_acquire(void) {
+    pthread_mutex_lock(&bank_mutex);
+    question_bank_t *bank = current_bank;
+    atomic_fetch_add(&bank->refs, 1);
+    pthread_mutex_unlock(&bank_mutex);
+    return bank;
+}
+
+void bank_release(question_bank_t *bank) {
+    if (atomic_fetch_sub(&bank->refs, 1) == 1) {
+        free_bank(bank);
+    }
+}
+
+/*
+ * Swaps in a new bank. Sessions already running keep the old one until they
+ * release it, new sessions pick up the new one. Nobody waits on the swap.
+ */
+void bank_publish(question_bank_t *bank) {
+    atomic_store(&bank->refs, 1);
+
+    pthread_mutex_lock(&bank_mutex);
+    question_bank_t *old = current_bank;
+    bank->generation = old ? old->generation + 1 : 1;
+    current_bank = bank;
+    pthread_mutex_unlock(&bank_mutex);
+
+    if (old) bank_release(old);
+}
+
+//FNV-1a of a username
+uint32_t hash_username(const char *username) {
+    uint32_t hash = 2166136261u;
+    for (const char *c = username; *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    return hash;
+}
+
+//Per-student question order, seeded from the username so it is repeatable
+void build_question_order(int *order, int count, const char *username) {
+    uint32_t seed = hash_username(username);
+    if (seed == 0) seed = 1;
+
+    for (int i = 0; i < count; i++) order[i] = i;
+    if (!shuffle_questions) return;
+
+    //Fisher-Yates with xorshift32
+    for (int i = count - 1; i > 0; i--) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        int j = seed % (uint32_t)(i + 1);
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+}
+
+//Sends two frames with one syscall, retrying on partial writes
+int send_frames(int sock, frame_t first, frame_t second) {
+    struct iovec iov[2] = {
+        { (void *)first.data, first.len },
+        { (void *)second.data, second.len }
+    };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    while (msg.msg_iovlen > 0) {
+        ssize_t sent = sendmsg(sock, &msg, 0);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        while (msg.msg_iovlen > 0 && (size_t)sent >= msg.msg_iov->iov_len) {
+            sent -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + sent;
+            msg.msg_iov->iov_len -= sent;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Metrics
+ * Each thread counts into its own shard, found through a thread-local
+ * pointer, so recording an event is a relaxed load and store on a cache line
+ * no other thread writes. Readers add up every shard without taking a lock.
+ * A shard outlives its thread: when a session ends the shard goes back on the
+ * registry for the next session thread, so its counts are never lost.
+ */
+enum {
+    M_ACCEPTED,
+    M_QUEUED,
+    M_REJECTED,
+    M_TIMED_OUT,
+    M_WAITERS_GONE,
+    M_SLOW_CONSUMERS,
+    M_AUTH_FAILURES,
+    M_QUESTIONS_SENT,
+    M_ANSWERS_RECEIVED,
+    M_EXAMS_COMPLETED,
+    M_JOURNAL_LOST,
+    METRIC_COUNTERS
+};
+
+enum {
+    H_AUTH,
+    H_ANSWER,
+    H_BROADCAST,
+    METRIC_HISTOGRAMS
+};
+
+static const char *counter_names[METRIC_COUNTERS][2] = {
+    { "exam_connections_accepted_total", "Connections accepted from the listen socket" },
+    { "exam_connections_queued_total", "Connections parked in the waiting room" },
+    { "exam_connections_rejected_total", "Connections turned away" },
+    { "exam_connections_timed_out_total", "Sessions and waiters closed by a deadline" },
+    { "exam_waiters_gone_total", "Waiters dropped after hanging up" },
+    { "exam_slow_consumers_total", "Students dropped for not reading their output" },
+    { "exam_auth_failures_total", "Usernames refused at login" },
+    { "exam_questions_sent_total", "Questions sent to students" },
+    { "exam_answers_received_total", "Answers received from students" },
+    { "exam_exams_completed_total", "Exams finished with every question answered" },
+    { "exam_journal_records_lost_total", "Journal records that failed to write or sync" },
+};
+
+static const char *histogram_names[METRIC_HISTOGRAMS][2] = {
+    { "exam_auth_seconds", "Username received to AUTH_SUCCESS sent" },
+    { "exam_answer_seconds", "Question sent to answer received" },
+    { "exam_broadcast_seconds", "Time to fan a notice out to every student" },
+};
+
+//Bucket i counts values below 2^i microseconds, the last one is +Inf
+typedef struct {
+    atomic_ullong buckets[METRIC_BUCKETS];
+    atomic_ullong count;
+    atomic_ullong sum_us;
+} metric_hist_t;
+
+typedef struct metrics_shard {
+    struct metrics_shard *next;
+    atomic_int in_use;
+    atomic_ullong counters[METRIC_COUNTERS];
+    metric_hist_t histograms[METRIC_HISTOGRAMS];
+} __attribute__((aligned(64))) metrics_shard_t;
+
+_Atomic(metrics_shard_t *) metrics_registry = NULL;
+static __thread metrics_shard_t *thread_shard = NULL;
+
+uint64_t monotonic_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+//Claims a free shard for this thread, or adds a new one to the registry
+static metrics_shard_t *metrics_shard(void) {
+    if (thread_shard) return thread_shard;
+
+    metrics_shard_t *shard = atomic_load(&metrics_registry);
+    for (; shard; shard = shard->next) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&shard->in_use, &expected, 1)) break;
+    }
+
+    if (!shard) {
+        shard = aligned_alloc(64, sizeof(metrics_shard_t));
+        if (!shard) {
+            perror("Metrics shard allocation failed");
+            exit(EXIT_FAILURE);
+        }
+        memset(shard, 0, sizeof(metrics_shard_t));
+        atomic_store(&shard->in_use, 1);
+        shard->next = atomic_load(&metrics_registry);
+        while (!atomic_compare_exchange_weak(&metrics_registry, &shard->next, shard)) {
+        }
+    }
+
+    thread_shard = shard;
+    return shard;
+}
+
+//Hands the shard back when a session thread is about to exit
+void metrics_release(void) {
+    if (!thread_shard) return;
+    atomic_store_explicit(&thread_shard->in_use, 0, memory_order_release);
+    thread_shard = NULL;
+}
+
+//Only the owning thread writes a shard, so no read-modify-write is needed
+static inline void shard_add(atomic_ullong *value, uint64_t amount) {
+    atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + amount,
+                          memory_order_relaxed);
+}
+
+void metric_inc(int counter) {
+    shard_add(&metrics_shard()->counters[counter], 1);
+}
+
+void metric_add(int counter, uint64_t n) {
+    shard_add(&metrics_shard()->counters[counter], n);
+}
+
+void metric_observe(int histogram, uint64_t micros) {
+    metric_hist_t *h = &metrics_shard()->histograms[histogram];
+    int bucket = micros ? 64 - __builtin_clzll(micros) : 0;
+    if (bucket >= METRIC_BUCKETS) bucket = METRIC_BUCKETS - 1;
+    shard_add(&h->buckets[bucket], 1);
+    shard_add(&h->count, 1);
+    shard_add(&h->sum_us, micros);
+}
+
+uint64_t metric_total(int counter) {
+    uint64_t total = 0;
+    for (metrics_shard_t *shard = atomic_load(&metrics_registry); shard; shard = shard->next) {
+        total += atomic_load_explicit(&shard->counters[counter], memory_order_relaxed);
+    }
+    return total;
+}
+
+void print_admission_stats(void);
+
+//Owns SIGHUP and SIGUSR1 for the whole process: bank reloads and stats dumps
+void *signal_thread(void *arg) {
+    sigset_t *signals = (sigset_t *)arg;
+    int sig;
+
+    while (sigwait(signals, &sig) == 0) {
+        if (sig == SIGUSR1) {
+            print_admission_stats();
+            continue;
+        }
+        if (sig != SIGHUP) continue;
+
+        if (!bank_path) {
+            printf("SIGHUP: using built-in questions, nothing to reload\n");
+            continue;
+        }
+
+        question_bank_t *bank = load_bank_file(bank_path);
+        if (!bank) {
+            fprintf(stderr, "SIGHUP: reload of %s failed, keeping current bank\n", bank_path);
+            continue;
+        }
+        bank_publish(bank);
+        printf("SIGHUP: loaded %d questions from %s (generation %u)\n",
+               bank->count, bank_path, bank->generation);
+    }
+    return NULL;
+}
+
+/*
+ * Deadlines
+ * Every blocking read arms a deadline first. A hashed timer wheel with 100ms
+ * ticks keeps arm/disarm O(1); the timer thread walks one bucket per tick and
+ * shuts down the socket of anything that expired, which wakes the blocked
+ * recv(). Lock order is clients_mutex, then timer_mutex.
+ */
+uint64_t current_tick(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t ms = (now.tv_sec - timer_epoch.tv_sec) * 1000 +
+                  (now.tv_nsec - timer_epoch.tv_nsec) / 1000000;
+    return ms / TIMER_TICK_MS;
+}
+
+static void wheel_unlink(deadline_t *d) {
+    if (d->prev) {
+        d->prev->next = d->next;
+    } else {
+        timer_wheel[d->expires % TIMER_WHEEL_SLOTS] = d->next;
+    }
+    if (d->next) d->next->prev = d->prev;
+    d->prev = d->next = NULL;
+    d->armed = 0;
+}
+
+void deadline_arm(deadline_t *d, int fd, int seconds) {
+    pthread_mutex_lock(&timer_mutex);
+    if (d->armed) wheel_unlink(d);
+
+    uint64_t now = current_tick();
+    if (now < timer_tick) now = timer_tick;
+    uint64_t ticks = (uint64_t)seconds * 1000 / TIMER_TICK_MS;
+    d->expires = now + (ticks > 0 ? ticks : 1);
+    d->fd = fd;
+    d->fired = 0;
+    d->armed = 1;
+
+    deadline_t **bucket = &timer_wheel[d->expires % TIMER_WHEEL_SLOTS];
+    d->prev = NULL;
+    d->next = *bucket;
+    if (*bucket) (*bucket)->prev = d;
+    *bucket = d;
+    pthread_mutex_unlock(&timer_mutex);
+}
+
+//Returns 1 if the deadline had already fired
+int deadline_disarm(deadline_t *d) {
+    pthread_mutex_lock(&timer_mutex);
+    if (d->armed) wheel_unlink(d);
+    int fired = d->fired;
+    pthread_mutex_unlock(&timer_mutex);
+    return fired;
+}
+
+/*
+ * Waiting room
+ * Callers hold clients_mutex. Messages to waiters never block, a waiter that
+ * cannot take a one-line update is not worth holding the lock for. Waiters
+ * that hang up are dropped when the room is updated or full, so they can't
+ * hold places until -W runs out.
+ */
+int send_nonblocking(int fd, const char *message) {
+    return send(fd, message, strlen(message), MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+//Peer sent its FIN or a reset, nothing more will reach it
+int peer_gone(int fd) {
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) < 0) return 1;
+    return info.tcpi_state == TCP_CLOSE_WAIT || info.tcpi_state == TCP_CLOSE;
+}
+
+//Closes a connection we turned away without a reset eating the last message
+void close_gracefully(int fd) {
+    char discard[BUFFER_SIZE];
+    shutdown(fd, SHUT_WR);
+    while (recv(fd, discard, sizeof(discard), MSG_DONTWAIT) > 0) {
+    }
+    close(fd);
+}
+
+static void waiting_room_unlink(int index) {
+    waiter_t *w = &waiters[index];
+    if (w->prev >= 0) waiters[w->prev].next = w->next; else wait_head = w->next;
+    if (w->next >= 0) waiters[w->next].prev = w->prev; else wait_tail = w->prev;
+    w->queued = 0;
+    w->next = wait_free;
+    wait_free = index;
+    waiting_count--;
+}
+
+static void waiting_room_evict(int index) {
+    deadline_disarm(&waiters[index].deadline);
+    close(waiters[index].fd);
+    waiting_room_unlink(index);
+    metric_inc(M_WAITERS_GONE);
+    printf("Waiting student hung up\n");
+}
+
+//Drops every waiter that has hung up, returns how many went
+int waiting_room_prune(void) {
+    int evicted = 0;
+    for (int i = wait_head, next; i >= 0; i = next) {
+        next = waiters[i].next;
+        if (peer_gone(waiters[i].fd)) {
+            waiting_room_evict(i);
+            evicted++;
+        }
+    }
+    return evicted;
+}
+
+//Tells every waiter where it now stands
+void waiting_room_notify(void) {
+    char message[BUFFER_SIZE];
+    int position = 1;
+    waiting_room_prune();
+    for (int i = wait_head, next; i >= 0; i = next) {
+        next = waiters[i].next;
+        snprintf(message, BUFFER_SIZE, "WAITING:You are number %d in the waiting room.\n", position);
+        if (send_nonblocking(waiters[i].fd, message) < 0 && (errno == EPIPE || errno == ECONNRESET)) {
+            waiting_room_evict(i);
+            continue;
+        }
+        position++;
+    }
+}
+
+//Queues a connection, returns its position or 0 if the room is full
+int waiting_room_push(int fd, struct sockaddr_in *address) {
+    //Full rooms may be holding places for clients that already left
+    if (wait_free < 0 && waiting_room_prune() > 0) waiting_room_notify();
+    if (wait_free < 0) return 0;
+
+    int index = wait_free;
+    waiter_t *w = &waiters[index];
+    wait_free = w->next;
+
+    w->fd = fd;
+    w->address = *address;
+    w->queued = 1;
+    w->prev = wait_tail;
+    w->next = -1;
+    if (wait_tail >= 0) waiters[wait_tail].next = index; else wait_head = index;
+    wait_tail = index;
+    waiting_count++;
+
+    deadline_arm(&w->deadline, fd, wait_timeout_s);
+
+    char message[BUFFER_SIZE];
+    snprintf(message, BUFFER_SIZE, "WAITING:All seats are taken. You are number %d in the waiting room.\n",
+             waiting_count);
+    send_nonblocking(fd, message);
+    return waiting_count;
+}
+
+//Takes the longest waiting connection out of the room
+int waiting_room_pop(int *fd, struct sockaddr_in *address) {
+    if (wait_head < 0) return 0;
+
+    int index = wait_head;
+    deadline_disarm(&waiters[index].deadline);
+    *fd = waiters[index].fd;
+    *address = waiters[index].address;
+    waiting_room_unlink(index);
+    return 1;
+}
+
+//Timer thread callback for a waiter whose deadline fired
+void waiting_room_expire(int index) {
+    pthread_mutex_lock(&clients_mutex);
+    waiter_t *w = &waiters[index];
+
+    //It may have been promoted, or the entry reused, since the timer fired
+    pthread_mutex_lock(&timer_mutex);
+    int expired = w->queued && w->deadline.fired;
+    pthread_mutex_unlock(&timer_mutex);
+
+    if (expired) {
+        send_nonblocking(w->fd, "Server: Waited too long for a seat. Come back later.\n");
+        close_gracefully(w->fd);
+        waiting_room_unlink(index);
+        metric_inc(M_TIMED_OUT);
+        waiting_room_notify();
+        printf("Waiting student timed out\n");
+    }
+    pthread_mutex_unlock(&clients_mutex);
+}
+
+void *timer_thread(void *arg) {
+    int *expired_waiters = malloc((waiting_room_size + 1) * sizeof(int));
+    (void)arg;
+
+    while (1) {
+        usleep(TIMER_TICK_MS * 1000);
+        uint64_t now = current_tick();
+        int expired_count = 0;
+
+        pthread_mutex_lock(&timer_mutex);
+        while (timer_tick < now) {
+            timer_tick++;
+            deadline_t *d = timer_wheel[timer_tick % TIMER_WHEEL_SLOTS];
+            while (d) {
+                deadline_t *next = d->next;
+                if (d->expires <= timer_tick) {
+                    wheel_unlink(d);
+                    d->fired = 1;
+                    if (d->waiter < 0) {
+                        //Wakes the session thread blocked in recv()
+                        send_nonblocking(d->fd, "Server: Session timed out.\n");
+                        shutdown(d->fd, SHUT_RDWR);
+                    } else if (expired_count <= waiting_room_size) {
+                        expired_waiters[expired_count++] = d->waiter;
+                    }
+                }
+                d = next;
+            }
+        }
+        pthread_mutex_unlock(&timer_mutex);
+
+        for (int i = 0; i < expired_count; i++) {
+            waiting_room_expire(expired_waiters[i]);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Slow consumers
+ * A client that stops reading lets its unsent output pile up in the kernel.
+ * Once that queue passes max_outq_bytes the client is cut off instead of
+ * letting sends to it stall everybody else.
+ */
+int output_backlog(int fd) {
+    int pending = 0;
+    if (ioctl(fd, SIOCOUTQ, &pending) < 0) return 0;
+    return pending;
+}
+
+//Called with clients_mutex held
+void drop_slow_consumer(client_t *client) {
+    if (client->slow) return;
+    client->slow = 1;
+    metric_inc(M_SLOW_CONSUMERS);
+    printf("Dropping slow student %s\n", client->username);
+    shutdown(client->socket, SHUT_RDWR);
+}
+
+int client_backlogged(int client_index) {
+    pthread_mutex_lock(&clients_mutex);
+    client_t *client = &clients[client_index];
+    if (!client->slow && output_backlog(client->socket) > max_outq_bytes) {
+        drop_slow_consumer(client);
+    }
+    int slow = client->slow;
+    pthread_mutex_unlock(&clients_mutex);
+    return slow;
+}
+
+//recv() that gives up once the client has been idle for idle_timeout_s
+int recv_client(int client_index, char *buffer, size_t len) {
+    client_t *client = &clients[client_index];
+
+    deadline_arm(&client->deadline, client->socket, idle_timeout_s);
+    int bytes_received = recv(client->socket, buffer, len, 0);
+    if (deadline_disarm(&client->deadline)) {
+        metric_inc(M_TIMED_OUT);
+        printf("Client in slot %d timed out\n", client_index);
+        return 0;
+    }
+    return bytes_received;
+}
+
+void print_admission_stats(void) {
+    pthread_mutex_lock(&clients_mutex);
+    int active = active_sessions;
+    int waiting = waiting_count;
+    pthread_mutex_unlock(&clients_mutex);
+
+    printf("STATS: accepted=%lu queued=%lu rejected=%lu timed_out=%lu slow_consumers=%lu "
+           "active=%d/%d waiting=%d/%d\n",
+           (unsigned long)metric_total(M_ACCEPTED), (unsigned long)metric_total(M_QUEUED),
+           (unsigned long)metric_total(M_REJECTED), (unsigned long)metric_total(M_TIMED_OUT),
+           (unsigned long)metric_total(M_SLOW_CONSUMERS),
+           active, max_clients, waiting, waiting_room_size);
+    fflush(stdout);
+}
+
+/*
+ * Admin endpoint
+ * Serves the metrics in the Prometheus text format on a port bound to
+ * 127.0.0.1 only, e.g. curl http://127.0.0.1:9090/metrics. Scrapes are rare
+ * and cheap, so one thread answers them one at a time. If the port is taken
+ * the server runs without it rather than refusing to start.
+ */
+int admin_port = DEFAULT_ADMIN_PORT;
+
+typedef struct {
+    char data[ADMIN_RESPONSE_LEN];
+    size_t len;
+} admin_text_t;
+
+static void admin_printf(admin_text_t *text, const char *format, ...) {
+    if (text->len >= ADMIN_RESPONSE_LEN) return;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text->data + text->len, ADMIN_RESPONSE_LEN - text->len, format, args);
+    va_end(args);
+    if (n > 0) text->len += n;
+    //vsnprintf returns what it would have written, keep len on the buffer
+    if (text->len > ADMIN_RESPONSE_LEN - 1) text->len = ADMIN_RESPONSE_LEN - 1;
+}
+
+void render_metrics(admin_text_t *text) {
+    for (int c = 0; c < METRIC_COUNTERS; c++) {
+        admin_printf(text, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                     counter_names[c][0], counter_names[c][1], counter_names[c][0],
+                     counter_names[c][0], (unsigned long long)metric_total(c));
+    }
+
+    pthread_mutex_lock(&clients_mutex);
+    int active = active_sessions;
+    int waiting = waiting_count;
+    pthread_mutex_unlock(&clients_mutex);
+    question_bank_t *bank = bank_acquire();
+    int questions = bank->count;
+    unsigned generation = bank->generation;
+    bank_release(bank);
+
+    admin_printf(text, "# HELP exam_sessions_active Students holding a seat\n"
+                       "# TYPE exam_sessions_active gauge\nexam_sessions_active %d\n", active);
+    admin_printf(text, "# HELP exam_seats Seats available\n"
+                       "# TYPE exam_seats gauge\nexam_seats %d\n", max_clients);
+    admin_printf(text, "# HELP exam_waiting_room Connections waiting for a seat\n"
+                       "# TYPE exam_waiting_room gauge\nexam_waiting_room %d\n", waiting);
+    admin_printf(text, "# HELP exam_bank_questions Questions in the current bank\n"
+                       "# TYPE exam_bank_questions gauge\nexam_bank_questions %d\n", questions);
+    admin_printf(text, "# HELP exam_bank_generation Bank reloads since start, plus one\n"
+                       "# TYPE exam_bank_generation gauge\nexam_bank_generation %u\n", generation);
+
+    for (int h = 0; h < METRIC_HISTOGRAMS; h++) {
+        uint64_t buckets[METRIC_BUCKETS] = { 0 };
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+        for (metrics_shard_t *shard = atomic_load(&metrics_registry); shard; shard = shard->next) {
+            metric_hist_t *hist = &shard->histograms[h];
+            for (int b = 0; b < METRIC_BUCKETS; b++) {
+                buckets[b] += atomic_load_explicit(&hist->buckets[b], memory_order_relaxed);
+            }
+            count += atomic_load_explicit(&hist->count, memory_order_relaxed);
+            sum_us += atomic_load_explicit(&hist->sum_us, memory_order_relaxed);
+        }
+
+        const char *name = histogram_names[h][0];
+        admin_printf(text, "# HELP %s %s\n# TYPE %s histogram\n", name, histogram_names[h][1], name);
+        uint64_t cumulative = 0;
+        for (int b = 0; b < METRIC_BUCKETS - 1; b++) {
+            cumulative += buckets[b];
+            admin_printf(text, "%s_bucket{le=\"%.9g\"} %llu\n", name, (double)(1ULL << b) / 1e6,
+                         (unsigned long long)cumulative);
+        }
+        cumulative += buckets[METRIC_BUCKETS - 1];
+        //Shards are read without a lock, never let +Inf trail the buckets
+        if (count < cumulative) count = cumulative;
+        admin_printf(text, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)count);
+        admin_printf(text, "%s_sum %.6f\n%s_count %llu\n", name, sum_us / 1e6, name,
+                     (unsigned long long)count);
+    }
+}
+
+void *admin_thread(void *arg) {
+    int listen_fd = *(int *)arg;
+    static admin_text_t body;
+    char request[BUFFER_SIZE];
+    char header[256];
+
+    while (1) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+
+        struct timeval timeout = { 1, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        int n = recv(fd, request, sizeof(request) - 1, 0);
+        if (n <= 0) {
+            close(fd);
+            continue;
+        }
+        request[n] = '\0';
+
+        int found = strncmp(request, "GET /metrics", 12) == 0 || strncmp(request, "GET / ", 6) == 0;
+        body.len = 0;
+        if (found) {
+            render_metrics(&body);
+        } else {
+            admin_printf(&body, "Try /metrics\n");
+        }
+
+        int header_len = snprintf(header, sizeof(header),
+                                  "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                  "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                                  found ? "200 OK" : "404 Not Found", body.len);
+        frame_t head = { header, (size_t)header_len };
+        frame_t payload = { body.data, body.len };
+        send_frames(fd, head, payload);
+        close(fd);
+    }
+    return NULL;
+}
+
+/*
+ * Results journal
+ * Append-only text file with one tab-separated record per line:
+ *
+ *   AUTH    <unix ms> <username> <questions in bank>
+ *   RESUME  <unix ms> <username> <next position> <score>
+ *   ANSWER  <unix ms> <username> <position> <question index> <answer> <correct>
+ *   END     <unix ms> <username> <score> <questions in bank>
+ *
+ * Session threads format a record and push it onto a lock-free stack, they
+ * never touch the file. The writer thread takes everything pending at once,
+ * writes it with one write() and one fdatasync(), so records that arrive
+ * while a sync is running share the next one. Only the END record waits for
+ * its sync, answers never do. A batch that fails to write is retried a few
+ * times and cut back out of the file if it still fails; a failed sync is not
+ * retried (the kernel may already have dropped the pages), every record of
+ * that round is counted as lost and END waiters are told so.
+ */
+typedef struct journal_record {
+    struct journal_record *next;
+    int *synced;             //1 once the record is on disk, -1 if it was lost, NULL if nobody waits
+    int write_failed;        //Writer only, the waiter's flag is set under journal_mutex
+    size_t len;
+    char line[JOURNAL_LINE_LEN];
+} journal_record_t;
+
+//Exam a student started but did not finish, rebuilt from the journal
+typedef struct unfinished {
+    struct unfinished *next;
+    char username[MAX_USERNAME_LEN];
+    int next_position;
+    int score;
+    int count;
+} unfinished_t;
+
+const char *journal_path = DEFAULT_JOURNAL_PATH;
+int journal_fd = -1;
+_Atomic(journal_record_t *) journal_pending = NULL;
+sem_t journal_wakeup;
+pthread_mutex_t journal_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t journal_synced = PTHREAD_COND_INITIALIZER;
+
+unfinished_t *unfinished[UNFINISHED_BUCKETS];
+pthread_mutex_t unfinished_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+uint64_t wall_clock_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int journal_vappend(int *synced, const char *format, va_list args) {
+    if (journal_fd < 0) return -1;
+
+    journal_record_t *record = malloc(sizeof(journal_record_t));
+    if (!record) return -1;
+
+    int len = vsnprintf(record->line, JOURNAL_LINE_LEN, format, args);
+    if (len < 0 || len >= JOURNAL_LINE_LEN) {
+        free(record);
+        return -1;
+    }
+    record->len = len;
+    record->synced = synced;
+    record->write_failed = 0;
+
+    //The writer may free the record as soon as it is pushed, don't touch it after
+    record->next = atomic_load_explicit(&journal_pending, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&journal_pending, &record->next, record,
+                                                  memory_order_release, memory_order_relaxed)) {
+    }
+    sem_post(&journal_wakeup);
+    return 0;
+}
+
+//Queues one record and returns straight away
+void journal_append(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    journal_vappend(NULL, format, args);
+    va_end(args);
+}
+
+/*
+ * Queues one record and blocks until its batch has been synced.
+ * Returns 1 once it is on disk, 0 if the journal is off, -1 if it was lost.
+ */
+int journal_append_durable(const char *format, ...) {
+    if (journal_fd < 0) return 0;
+
+    int synced = 0;
+    va_list args;
+    va_start(args, format);
+    int queued = journal_vappend(&synced, format, args) == 0;
+    va_end(args);
+    if (!queued) {
+        metric_inc(M_JOURNAL_LOST);
+        return -1;
+    }
+
+    pthread_mutex_lock(&journal_mutex);
+    while (!synced) {
+        pthread_cond_wait(&journal_synced, &journal_mutex);
+    }
+    pthread_mutex_unlock(&journal_mutex);
+    return synced;
+}
+
+//Writes one batch at the current offset; on failure cuts the file back so no torn line is left
+static int journal_write_batch(const char *batch, size_t used) {
+    off_t start = lseek(journal_fd, 0, SEEK_CUR);
+
+    for (int attempt = 0; attempt < JOURNAL_WRITE_RETRIES; attempt++) {
+        if (attempt > 0) {
+            usleep(JOURNAL_RETRY_MS * 1000);
+            if (start < 0 || lseek(journal_fd, start, SEEK_SET) < 0) break;
+        }
+        size_t written = 0;
+        while (written < used) {
+            ssize_t n = write(journal_fd, batch + written, used - written);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            written += n;
+        }
+        if (written == used) return 1;
+        perror("Journal write failed");
+    }
+
+    if (start >= 0 && (ftruncate(journal_fd, start) < 0 || lseek(journal_fd, start, SEEK_SET) < 0)) {
+        perror("Journal truncate failed");
+    }
+    return 0;
+}
+
+void *journal_thread(void *arg) {
+    char *batch = malloc(JOURNAL_BATCH_LEN);
+    (void)arg;
+
+    while (1) {
+        sem_wait(&journal_wakeup);
+        journal_record_t *taken = atomic_exchange_explicit(&journal_pending, NULL, memory_order_acquire);
+        if (!taken) continue;
+
+        //The stack hands records back newest first, put them in order
+        journal_record_t *ordered = NULL;
+        while (taken) {
+            journal_record_t *next = taken->next;
+            taken->next = ordered;
+            ordered = taken;
+            taken = next;
+        }
+
+        //Waiters are kept with the result of their own batch until the sync is done
+        journal_record_t *waiting = NULL;
+        size_t round_records = 0;
+        size_t lost = 0;
+        while (ordered) {
+            size_t used = 0;
+            size_t records = 0;
+            journal_record_t *batch_waiting = NULL;
+            while (ordered && used + ordered->len <= JOURNAL_BATCH_LEN) {
+                journal_record_t *next = ordered->next;
+                memcpy(batch + used, ordered->line, ordered->len);
+                used += ordered->len;
+                records++;
+                if (ordered->synced) {
+                    ordered->next = batch_waiting;
+                    batch_waiting = ordered;
+                } else {
+                    free(ordered);
+                }
+                ordered = next;
+            }
+            round_records += records;
+
+            int written = journal_write_batch(batch, used);
+            if (!written) lost += records;
+            while (batch_waiting) {
+                journal_record_t *next = batch_waiting->next;
+                batch_waiting->write_failed = !written;
+                batch_waiting->next = waiting;
+                waiting = batch_waiting;
+                batch_waiting = next;
+            }
+        }
+
+        int sync_failed = fdatasync(journal_fd) < 0;
+        if (sync_failed) {
+            perror("Journal sync failed");
+            lost = round_records;
+        }
+        if (lost > 0) {
+            fprintf(stderr, "Journal: %zu records may not be on disk\n", lost);
+            metric_add(M_JOURNAL_LOST, lost);
+        }
+
+        if (waiting) {
+            pthread_mutex_lock(&journal_mutex);
+            for (journal_record_t *record = waiting; record; record = record->next) {
+                *record->synced = (sync_failed || record->write_failed) ? -1 : 1;
+            }
+            pthread_cond_broadcast(&journal_synced);
+            pthread_mutex_unlock(&journal_mutex);
+
+            while (waiting) {
+                journal_record_t *next = waiting->next;
+                free(waiting);
+                waiting = next;
+            }
+        }
+    }
+    return NULL;
+}
+
+//Remembers where a student stopped, replacing any older entry
+void unfinished_save(const char *username, int next_position, int score, int count) {
+    uint32_t bucket = hash_username(username) % UNFINISHED_BUCKETS;
+
+    pthread_mutex_lock(&unfinished_mutex);
+    unfinished_t *entry = unfinished[bucket];
+    while (entry && strcmp(entry->username, username) != 0) entry = entry->next;
+    if (!entry) {
+        entry = calloc(1, sizeof(unfinished_t));
+        if (!entry) {
+            pthread_mutex_unlock(&unfinished_mutex);
+            return;
+        }
+        snprintf(entry->username, MAX_USERNAME_LEN, "%s", username);
+        entry->next = unfinished[bucket];
+        unfinished[bucket] = entry;
+    }
+    entry->next_position = next_position;
+    entry->score = score;
+    entry->count = count;
+    pthread_mutex_unlock(&unfinished_mutex);
+}
+
+//Removes and returns a student's unfinished exam, if there is one
+int unfinished_take(const char *username, unfinished_t *out) {
+    uint32_t bucket = hash_username(username) % UNFINISHED_BUCKETS;
+
+    pthread_mutex_lock(&unfinished_mutex);
+    unfinished_t **link = &unfinished[bucket];
+    while (*link && strcmp((*link)->username, username) != 0) link = &(*link)->next;
+    unfinished_t *entry = *link;
+    if (entry) {
+        *link = entry->next;
+        *out = *entry;
+        free(entry);
+    }
+    pthread_mutex_unlock(&unfinished_mutex);
+    return entry != NULL;
+}
+
+//Splits a journal line into tab-separated fields, returns how many
+static int split_fields(char *line, char **fields, int max_fields) {
+    int count = 0;
+    while (count < max_fields) {
+        fields[count++] = line;
+        char *tab = strchr(line, '\t');
+        if (!tab) break;
+        *tab = '\0';
+        line = tab + 1;
+    }
+    return count;
+}
+
+/*
+ * Crash recovery
+ * Replays the journal into the unfinished table before the server accepts
+ * anyone, then opens it for appending. A torn last line from a crash is
+ * cut off so new records start on a clean line.
+ */
+int journal_open(void) {
+    int fd = open(journal_path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror(journal_path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror("Journal stat failed");
+        close(fd);
+        return -1;
+    }
+
+    int records = 0;
+    off_t good_end = 0;
+    if (st.st_size > 0) {
+        char *base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) {
+            perror("Journal mmap failed");
+            close(fd);
+            return -1;
+        }
+
+        char *p = base;
+        char *end = base + st.st_size;
+        char *eol;
+        while (p < end && (eol = memchr(p, '\n', end - p)) != NULL) {
+            *eol = '\0';
+            char *fields[8];
+            int n = split_fields(p, fields, 8);
+            const char *type = fields[0];
+
+            if (strcmp(type, "AUTH") == 0 && n >= 4) {
+                unfinished_save(fields[2], 0, 0, atoi(fields[3]));
+            } else if (strcmp(type, "RESUME") == 0 && n >= 5) {
+                unfinished_t state;
+                if (unfinished_take(fields[2], &state)) {
+                    unfinished_save(fields[2], atoi(fields[3]), atoi(fields[4]), state.count);
+                }
+            } else if (strcmp(type, "ANSWER") == 0 && n >= 7) {
+                unfinished_t state;
+                if (unfinished_take(fields[2], &state)) {
+                    unfinished_save(fields[2], atoi(fields[3]) + 1, state.score + atoi(fields[6]), state.count);
+                }
+            } else if (strcmp(type, "END") == 0 && n >= 3) {
+                unfinished_t state;
+                unfinished_take(fields[2], &state);
+            }
+
+            records++;
+            p = eol + 1;
+        }
+        good_end = p - base;
+        munmap(base, st.st_size);
+
+        if (good_end < st.st_size) {
+            fprintf(stderr, "Journal: dropping %ld bytes of torn record\n", (long)(st.st_size - good_end));
+            if (ftruncate(fd, good_end) < 0) perror("Journal truncate failed");
+        }
+    }
+
+    if (lseek(fd, good_end, SEEK_SET) < 0) {
+        perror("Journal seek failed");
+        close(fd);
+        return -1;
+    }
+
+    int in_progress = 0;
+    for (int i = 0; i < UNFINISHED_BUCKETS; i++) {
+        for (unfinished_t *entry = unfinished[i]; entry; entry = entry->next) in_progress++;
+    }
+    printf("Journal %s: replayed %d records, %d exams in progress\n", journal_path, records, in_progress);
+
+    journal_fd = fd;
+    sem_init(&journal_wakeup, 0, 0);
+    return 0;
+}
+
+void *handle_client(void *arg);
+
+//Puts a connection into a free exam slot. Called with clients_mutex held.
+int start_session(int index, int fd, struct sockaddr_in *address) {
+    client_t *client = &clients[index];
+    client->socket = fd;
+    client->address = *address;
+    client->active = 1;
+    client->authenticated = 0;
+    client->slow = 0;
+    memset(client->username, 0, MAX_USERNAME_LEN);
+
+    //Blocking sends give up after the idle timeout too
+    struct timeval send_timeout = { idle_timeout_s, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+    
+    //Feedback and the user list go out as separate small sends, don't let Nagle hold them
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    pthread_t thread;
+    if (pthread_create(&thread, &session_attr, handle_client, &client_indices[index]) != 0) {
+        perror("Thread creation failed");
+        client->active = 0;
+        close(fd);
+        metric_inc(M_REJECTED);
+        return -1;
+    }
+    active_sessions++;
+    printf("Client slot %d allocated\n", index);
+    return 0;
+}
+
+//Frees an exam slot and hands it straight to the head of the waiting room
+void end_session(int index) {
+    client_t *client = &clients[index];
+    int fd = client->socket;
+
+    deadline_disarm(&client->deadline);
+
+    pthread_mutex_lock(&clients_mutex);
+    client->active = 0;
+    client->authenticated = 0;
+    active_sessions--;
+
+    int next_fd;
+    struct sockaddr_in next_address;
+    int promoted = 0;
+    while (!promoted && waiting_room_pop(&next_fd, &next_address)) {
+        promoted = start_session(index, next_fd, &next_address) == 0;
+    }
+    if (promoted) waiting_room_notify();
+    pthread_mutex_unlock(&clients_mutex);
+
+    close(fd);
+    metrics_release();
+    pthread_exit(NULL);
+}
 
 //Broadcasting message to all clients on server function.
 void broadcast_message(const char *message, int exclude_socket) {
+    uint64_t started = monotonic_us();
+    size_t len = strlen(message);
     pthread_mutex_lock(&clients_mutex);
     
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].active && clients[i].authenticated && clients[i].socket != exclude_socket) {
-            send(clients[i].socket, message, strlen(message), 0);
+    for (int i = 0; i < max_clients; i++) {
+        client_t *client = &clients[i];
+        if (!client->active || !client->authenticated || client->slow || client->socket == exclude_socket) {
+            continue;
+        }
+        
+        //Never block the whole server on one student who stopped reading
+        if (output_backlog(client->socket) > max_outq_bytes) {
+            drop_slow_consumer(client);
+            continue;
+        }
+        ssize_t sent = send(client->socket, message, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if ((sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) ||
+            (sent >= 0 && (size_t)sent < len)) {
+            drop_slow_consumer(client);
         }
     }
     
     pthread_mutex_unlock(&clients_mutex);
+    metric_observe(H_BROADCAST, monotonic_us() - started);
 }
 
 //Send user list to specific client
 void send_active_users(int client_socket) {
     char user_list[BUFFER_SIZE] = "Active users: ";
+    size_t used = strlen(user_list);
     pthread_mutex_lock(&clients_mutex);
     
-    for (int i = 0; i < MAX_CLIENTS; i++) {
+    //With many seats the list can outgrow the buffer, cut it short
+    for (int i = 0; i < max_clients; i++) {
         if (clients[i].active && clients[i].authenticated) {
-            strcat(user_list, clients[i].username);
-            strcat(user_list, " ");
+            size_t name_len = strlen(clients[i].username);
+            if (used + name_len + 5 >= BUFFER_SIZE) {
+                memcpy(user_list + used, "...", 3);
+                used += 3;
+                break;
+            }
+            memcpy(user_list + used, clients[i].username, name_len);
+            used += name_len;
+            user_list[used++] = ' ';
         }
     }
-    strcat(user_list, "\n");
+    user_list[used++] = '\n';
+    user_list[used] = '\0';
     
     pthread_mutex_unlock(&clients_mutex);
-    send(client_socket, user_list, strlen(user_list), 0);
+    send(client_socket, user_list, used, MSG_NOSIGNAL);
 }
 
 
-int authenticate_user(const char *username) {
+//Checks the name and claims it for client_index in one step, so two logins
+//with the same name can't both pass and share a journal and resume entry
+int authenticate_user(int client_index, const char *username) {
     //Most basic authentication 
-    if (strlen(username) < 1) return 0;
+    size_t len = strlen(username);
+    if (len < 1 || len >= MAX_USERNAME_LEN) return 0;
+    
+    //Names go into the tab-separated journal, keep them printable
+    for (const char *c = username; *c; c++) {
+        if ((unsigned char)*c < ' ' || *c == 0x7f) return 0;
+    }
     
     //Check if username existance
     pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; i++) {
+    for (int i = 0; i < max_clients; i++) {
         if (clients[i].active && clients[i].authenticated && 
             strcmp(clients[i].username, username) == 0) {
             pthread_mutex_unlock(&clients_mutex);
             return 0;
         }
     }
+    strcpy(clients[client_index].username, username);
+    clients[client_index].authenticated = 1;
     pthread_mutex_unlock(&clients_mutex);
     
     return 1; 
@@ -94,6 +1508,7 @@ void *handle_client(void *arg) {
     int client_socket = clients[client_index].socket;
     char buffer[BUFFER_SIZE];
     int questions_answered = 0;
+    int first_position = 0;
     
     printf("Client connected from %s:%d\n", 
            inet_ntoa(clients[client_index].address.sin_addr),
@@ -101,86 +1516,146 @@ void *handle_client(void *arg) {
     
     while (1) {
         memset(buffer, 0, BUFFER_SIZE);
-        int bytes_received = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
+        int bytes_received = recv_client(client_index, buffer, BUFFER_SIZE - 1);
         
         if (bytes_received <= 0) {
             printf("Client disconnected!\n");
-            clients[client_index].active = 0;
-            close(client_socket);
-            pthread_exit(NULL);
+            end_session(client_index);
         }
         
         buffer[bytes_received] = '\0';
         
+        uint64_t auth_started = monotonic_us();
         char *newline = strchr(buffer, '\n');
         if (newline) *newline = '\0';
+        //Clients that end lines with CRLF
+        size_t length = strlen(buffer);
+        if (length > 0 && buffer[length - 1] == '\r') buffer[length - 1] = '\0';
         
-        if (authenticate_user(buffer)) {
-            strcpy(clients[client_index].username, buffer);
-            clients[client_index].authenticated = 1;
-            
+        if (authenticate_user(client_index, buffer)) {
             send(client_socket, "AUTH_SUCCESS\n", 13, 0);
+            metric_observe(H_AUTH, monotonic_us() - auth_started);
             
             char welcome_msg[BUFFER_SIZE];
             snprintf(welcome_msg, BUFFER_SIZE, 
-                    "Welcome %s! You are authenticated\n", buffer);
+                    "Welcome %s! You are authenticated\n", clients[client_index].username);
             send(client_socket, welcome_msg, strlen(welcome_msg), 0);
             
             // Notify other users
             char notification[BUFFER_SIZE];
-            snprintf(notification, BUFFER_SIZE, "Student %s has joined the exam.\n", buffer);
+            snprintf(notification, BUFFER_SIZE, "Student %s has joined the exam.\n",
+                     clients[client_index].username);
             broadcast_message(notification, client_socket);
             
             break;
         } else {
             send(client_socket, "AUTH_FAILED\n", 12, 0);
+            metric_inc(M_AUTH_FAILURES);
         }
     }
     
+    //Session keeps this bank for its whole exam, even across a reload
+    question_bank_t *bank = bank_acquire();
+    int *order = malloc(bank->count * sizeof(int));
+    if (!order) {
+        bank_release(bank);
+        end_session(client_index);
+    }
+    const char *username = clients[client_index].username;
+    build_question_order(order, bank->count, username);
+    
+    //Pick up where the student stopped if the bank is still the same size
+    unfinished_t progress;
+    if (unfinished_take(username, &progress) && progress.count == bank->count &&
+        progress.next_position < bank->count) {
+        first_position = progress.next_position;
+        questions_answered = progress.score;
+        journal_append("RESUME\t%llu\t%s\t%d\t%d\n", (unsigned long long)wall_clock_ms(),
+                       username, first_position, questions_answered);
+        
+        char resume_msg[BUFFER_SIZE];
+        snprintf(resume_msg, BUFFER_SIZE, "Resuming your exam at question %d of %d.\n",
+                 first_position + 1, bank->count);
+        send(client_socket, resume_msg, strlen(resume_msg), MSG_NOSIGNAL);
+    } else {
+        journal_append("AUTH\t%llu\t%s\t%d\n", (unsigned long long)wall_clock_ms(),
+                       username, bank->count);
+    }
+    
     //Exam phase, send and recieve
-    for (int i = 0; i < total_questions; i++) {
-        // Send question
-        char question_msg[BUFFER_SIZE + 50];
-        snprintf(question_msg, BUFFER_SIZE + 50, "QUESTION_%d:%s", 
-                i + 1, exam_questions[i].question);
-        send(client_socket, question_msg, strlen(question_msg), 0);
+    int position = first_position;
+    for (; position < bank->count; position++) {
+        int i = position;
+        bank_question_t *question = &bank->questions[order[i]];
+        
+        if (client_backlogged(client_index)) break;
+        
+        // Send question, prefix and body go out straight from the bank
+        if (send_frames(client_socket, bank->headers[i], question->text) < 0) {
+            printf("Client %s disconnected during exam\n", clients[client_index].username);
+            break;
+        }
+        uint64_t question_sent = monotonic_us();
+        metric_inc(M_QUESTIONS_SENT);
         
         //Receive answer
         memset(buffer, 0, BUFFER_SIZE);
-        int bytes_received = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
+        int bytes_received = recv_client(client_index, buffer, BUFFER_SIZE - 1);
         
         if (bytes_received <= 0) {
             printf("Client %s disconnected during exam\n", clients[client_index].username);
             break;
         }
         
+        metric_observe(H_ANSWER, monotonic_us() - question_sent);
+        metric_inc(M_ANSWERS_RECEIVED);
+        
         buffer[bytes_received] = '\0';
         char *newline = strchr(buffer, '\n');
         if (newline) *newline = '\0';
         
         // Check answer
-        char feedback[BUFFER_SIZE];
-        if (buffer[0] == exam_questions[i].correct_answer) {
-            snprintf(feedback, BUFFER_SIZE, "Server/Teacher: Correct!\n");
+        const frame_t *feedback;
+        int correct = buffer[0] == question->correct_answer;
+        if (correct) {
+            feedback = &correct_feedback;
             questions_answered++;
         } else {
-            snprintf(feedback, BUFFER_SIZE, "Server/Teacher: Incorrect! The correct answer was %c\n", 
-                    exam_questions[i].correct_answer);
+            feedback = &question->wrong_feedback;
         }
         
-        send(client_socket, feedback, strlen(feedback), 0);
+        char answer = buffer[0] > ' ' && buffer[0] < 0x7f ? buffer[0] : '-';
+        journal_append("ANSWER\t%llu\t%s\t%d\t%d\t%c\t%d\n", (unsigned long long)wall_clock_ms(),
+                       username, i, order[i], answer, correct);
+        
+        send(client_socket, feedback->data, feedback->len, MSG_NOSIGNAL);
         
         //Send active users list after each question
         send_active_users(client_socket);
         
-        sleep(1); 
+        if (question_pace_ms > 0) usleep(question_pace_ms * 1000);
+    }
+    
+    //Exam success, the score is on disk before the student hears it
+    int result_lost = 0;
+    if (position == bank->count) {
+        if (journal_append_durable("END\t%llu\t%s\t%d\t%d\n", (unsigned long long)wall_clock_ms(),
+                                   username, questions_answered, bank->count) < 0) {
+            //Say so rather than show a score as saved when it is not
+            fprintf(stderr, "Result for %s (%d/%d) was not saved to the journal\n",
+                    username, questions_answered, bank->count);
+            result_lost = 1;
+        }
+        metric_inc(M_EXAMS_COMPLETED);
+    } else {
+        unfinished_save(username, position, questions_answered, bank->count);
     }
     
-    //Exam success
     char completion_msg[BUFFER_SIZE];
     snprintf(completion_msg, BUFFER_SIZE, 
-            "EXAM_END:Exam session ended. Thank you, %s! You answered %d/%d questions correctly.\n",
-            clients[client_index].username, questions_answered, total_questions);
+            "EXAM_END:Exam session ended. Thank you, %s! You answered %d/%d questions correctly.%s\n",
+            clients[client_index].username, questions_answered, bank->count,
+            result_lost ? " Your result could not be saved, please tell the invigilator." : "");
     send(client_socket, completion_msg, strlen(completion_msg), 0);
     
     // Notify other users
@@ -190,27 +1665,146 @@ void *handle_client(void *arg) {
     broadcast_message(leave_msg, client_socket);
     
     printf("Student %s completed exam with %d/%d correct answers\n", 
-           clients[client_index].username, questions_answered, total_questions);
+           clients[client_index].username, questions_answered, bank->count);
     
-    //Let's clean it all up
-    close(client_socket);
-    clients[client_index].active = 0;
-    clients[client_index].authenticated = 0;
+    free(order);
+    bank_release(bank);
     
-    pthread_exit(NULL);
+    //Let's clean it all up
+    end_session(client_index);
+    return NULL;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     int server_socket;
     struct sockaddr_in server_addr;
-    pthread_t threads[MAX_CLIENTS];
-    int client_indices[MAX_CLIENTS];
+    int opt;
     
-    //Initialise client array
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        clients[i].active = 0;
-        clients[i].authenticated = 0;
-        memset(clients[i].username, 0, MAX_USERNAME_LEN);
+    while ((opt = getopt(argc, argv, "q:op:d:c:b:w:i:W:Q:j:m:")) != -1) {
+        switch (opt) {
+        case 'q':
+            bank_path = optarg;
+            break;
+        case 'o':
+            shuffle_questions = 0;
+            break;
+        case 'p':
+            server_port = atoi(optarg);
+            break;
+        case 'd':
+            question_pace_ms = atoi(optarg);
+            break;
+        case 'c':
+            max_clients = atoi(optarg);
+            break;
+        case 'b':
+            listen_backlog = atoi(optarg);
+            break;
+        case 'w':
+            waiting_room_size = atoi(optarg);
+            break;
+        case 'i':
+            idle_timeout_s = atoi(optarg);
+            break;
+        case 'W':
+            wait_timeout_s = atoi(optarg);
+            break;
+        case 'Q':
+            max_outq_bytes = atoi(optarg);
+            break;
+        case 'j':
+            journal_path = strcmp(optarg, "none") == 0 ? NULL : optarg;
+            break;
+        case 'm':
+            admin_port = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [options]\n", argv[0]);
+            fprintf(stderr, "  -q  load questions from a bank file, SIGHUP reloads it\n");
+            fprintf(stderr, "  -o  ask questions in bank order instead of per-student order\n");
+            fprintf(stderr, "  -p  port to listen on (default 8080)\n");
+            fprintf(stderr, "  -d  pause after each answer in milliseconds (default 1000)\n");
+            fprintf(stderr, "  -c  exam seats, students sitting at once (default %d)\n", MAX_CLIENTS);
+            fprintf(stderr, "  -b  listen backlog (default %d)\n", DEFAULT_BACKLOG);
+            fprintf(stderr, "  -w  waiting room places, 0 rejects when full (default %d)\n", DEFAULT_WAITING_ROOM);
+            fprintf(stderr, "  -i  idle timeout for a student in seconds (default %d)\n", DEFAULT_IDLE_TIMEOUT);
+            fprintf(stderr, "  -W  longest wait for a seat in seconds (default %d)\n", DEFAULT_WAIT_TIMEOUT);
+            fprintf(stderr, "  -Q  unread output in bytes before a student is dropped (default %d)\n", DEFAULT_MAX_OUTQ);
+            fprintf(stderr, "  -j  results journal, \"none\" turns it off (default %s)\n", DEFAULT_JOURNAL_PATH);
+            fprintf(stderr, "  -m  local metrics port, 0 turns it off (default %d)\n", DEFAULT_ADMIN_PORT);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (max_clients < 1 || listen_backlog < 1 || waiting_room_size < 0 ||
+        idle_timeout_s < 1 || wait_timeout_s < 1 || max_outq_bytes < 1) {
+        fprintf(stderr, "Seats, backlog, timeouts and output limit must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    //Loading the question bank before anyone can connect
+    question_bank_t *bank = bank_path ? load_bank_file(bank_path) : load_builtin_bank();
+    if (!bank) {
+        fprintf(stderr, "No usable question bank\n");
+        exit(EXIT_FAILURE);
+    }
+    bank_publish(bank);
+    printf("Loaded %d questions from %s\n", bank->count, bank_path ? bank_path : "built-in list");
+    
+    //SIGHUP and SIGUSR1 are handled by one thread only, every other thread inherits the block
+    static sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    
+    pthread_t signal_tid;
+    if (pthread_create(&signal_tid, NULL, signal_thread, &signals) != 0) {
+        perror("Signal thread creation failed");
+        exit(EXIT_FAILURE);
+    }
+    pthread_detach(signal_tid);
+    
+    //Initialise client array and waiting room
+    clients = calloc(max_clients, sizeof(client_t));
+    client_indices = calloc(max_clients, sizeof(int));
+    waiters = calloc(waiting_room_size + 1, sizeof(waiter_t));
+    if (!clients || !client_indices || !waiters) {
+        perror("Client table allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < max_clients; i++) {
+        client_indices[i] = i;
+        clients[i].deadline.waiter = -1;
+    }
+    for (int i = 0; i < waiting_room_size; i++) {
+        waiters[i].deadline.waiter = i;
+        waiters[i].next = i + 1 < waiting_room_size ? i + 1 : -1;
+    }
+    wait_free = waiting_room_size > 0 ? 0 : -1;
+    
+    //Sessions are never joined, and a small stack lets thousands of them run
+    pthread_attr_init(&session_attr);
+    pthread_attr_setdetachstate(&session_attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&session_attr, THREAD_STACK_SIZE);
+    
+    clock_gettime(CLOCK_MONOTONIC, &timer_epoch);
+    pthread_t timer_tid;
+    if (pthread_create(&timer_tid, NULL, timer_thread, NULL) != 0) {
+        perror("Timer thread creation failed");
+        exit(EXIT_FAILURE);
+    }
+    pthread_detach(timer_tid);
+    
+    //Replay the results journal before anyone can resume from it
+    if (journal_path) {
+        if (journal_open() < 0) exit(EXIT_FAILURE);
+        pthread_t journal_tid;
+        if (pthread_create(&journal_tid, NULL, journal_thread, NULL) != 0) {
+            perror("Journal thread creation failed");
+            exit(EXIT_FAILURE);
+        }
+        pthread_detach(journal_tid);
     }
     
     //Creating server socket
@@ -223,9 +1817,9 @@ int main() {
     //Configuring server address
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(8080);
+    server_addr.sin_port = htons(server_port);
     
-    int opt = 1;
+    opt = 1;
     setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
     
     //Binding Socket
@@ -236,13 +1830,39 @@ int main() {
     }
     
     //Listen for connections
-    if (listen(server_socket, MAX_CLIENTS) < 0) {
+    if (listen(server_socket, listen_backlog) < 0) {
         perror("Listen failed");
         close(server_socket);
         exit(EXIT_FAILURE);
     }
     
-    printf("Exam Server started on port 8080\n");
+    //Metrics port, only reachable from this machine
+    static int admin_socket;
+    if (admin_port > 0) {
+        struct sockaddr_in admin_addr = { 0 };
+        admin_addr.sin_family = AF_INET;
+        admin_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        admin_addr.sin_port = htons(admin_port);
+        
+        admin_socket = socket(AF_INET, SOCK_STREAM, 0);
+        opt = 1;
+        setsockopt(admin_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        pthread_t admin_tid;
+        if (admin_socket < 0 ||
+            bind(admin_socket, (struct sockaddr *)&admin_addr, sizeof(admin_addr)) < 0 ||
+            listen(admin_socket, 16) < 0 ||
+            pthread_create(&admin_tid, NULL, admin_thread, &admin_socket) != 0) {
+            //Metrics are optional, the exam still runs without them
+            perror("Admin port setup failed, running without metrics");
+            if (admin_socket >= 0) close(admin_socket);
+        } else {
+            pthread_detach(admin_tid);
+            printf("Metrics on http://127.0.0.1:%d/metrics\n", admin_port);
+        }
+    }
+    
+    printf("Exam Server started on port %d with %d seats and %d waiting places\n",
+           server_port, max_clients, waiting_room_size);
     printf("Waiting for connections...\n");
     
     while (1) {
@@ -256,37 +1876,32 @@ int main() {
             continue;
         }
         
-        //Finding available slot for new client
+        metric_inc(M_ACCEPTED);
+        
+        //Finding available slot for new client, or a place in the waiting room
         pthread_mutex_lock(&clients_mutex);
         int slot_found = 0;
-        for (int i = 0; i < MAX_CLIENTS; i++) {
+        int position = 0;
+        for (int i = 0; i < max_clients; i++) {
             if (!clients[i].active) {
-                clients[i].socket = client_socket;
-                clients[i].address = client_addr;
-                clients[i].active = 1;
-                clients[i].authenticated = 0;
-                memset(clients[i].username, 0, MAX_USERNAME_LEN);
-                
-                client_indices[i] = i;
                 slot_found = 1;
-                
-                // Create thread for new client
-                if (pthread_create(&threads[i], NULL, handle_client, &client_indices[i]) != 0) {
-                    perror("Thread creation failed");
-                    clients[i].active = 0;
-                    close(client_socket);
-                } else {
-                    printf("Client slot %d allocated\n", i);
-                }
+                start_session(i, client_socket, &client_addr);
                 break;
             }
         }
+        if (!slot_found) {
+            position = waiting_room_push(client_socket, &client_addr);
+        }
         pthread_mutex_unlock(&clients_mutex);
         
-        if (!slot_found) {
+        if (position > 0) {
+            metric_inc(M_QUEUED);
+            printf("Student queued at position %d\n", position);
+        } else if (!slot_found) {
             char *reject_msg = "Server: Max student limit reached. Come back later.\n";
-            send(client_socket, reject_msg, strlen(reject_msg), 0);
-            close(client_socket);
+            send(client_socket, reject_msg, strlen(reject_msg), MSG_NOSIGNAL);
+            close_gracefully(client_socket);
+            metric_inc(M_REJECTED);
             printf("Student rejected\n");
         }
     }
@@ -294,4 +1909,4 @@ int main() {
     close(server_socket);
     pthread_mutex_destroy(&clients_mutex);
     return 0;
-}
\ No newline at end of file
+}
\ No newline at end of file
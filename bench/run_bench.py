@@ -0,0 +1,477 @@
+#!/usr/bin/env python3
+"""
+Benchmark and regression suite for every question in the repo.
+
+Inputs are generated from fixed seeds so every run measures the same work:
+a large sensor log for 2/sensor_log, float arrays for the tempstats
+extension, a drink count for the producer-consumer queue, scripted exam
+sessions for the exam server (with and without its results journal), a
+roster for sort_students and a tree of binaries for elf_inspect.
+
+Each benchmark reports wall time, throughput, p99 latency (where the program
+has a per-item latency) and peak RSS, as the median of a few repeats. The
+numbers are compared against bench/baseline.json and any metric that is worse
+than its tolerance allows, or any wrong output, fails the run.
+
+Normally run through make from the repo root:
+    make bench              build, run, compare
+    make bench-baseline     build, run, store the numbers as the new baseline
+"""
+
+import argparse
+import json
+import os
+import random
+import re
+import shutil
+import socket
+import statistics
+import subprocess
+import sys
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BASELINE = os.path.join(ROOT, "bench", "baseline.json")
+
+#Lower is better for everything except throughput
+HIGHER_IS_BETTER = {"throughput"}
+METRICS = ["wall_s", "throughput", "p99_us", "peak_rss_kb"]
+
+#Used when the baseline file has no tolerances of its own
+DEFAULT_TOLERANCE = {
+    "wall_s": {"relative": 0.5, "absolute": 0.05},
+    "throughput": {"relative": 0.35, "absolute": 0},
+    "p99_us": {"relative": 1.0, "absolute": 500},
+    "peak_rss_kb": {"relative": 0.25, "absolute": 4096},
+}
+
+
+class BenchFailure(Exception):
+    """A benchmark produced wrong output or could not run."""
+
+
+def run_child(cmd, cwd=None, timeout=300):
+    """Runs cmd under rusage_exec, returns (stdout, wall seconds, peak RSS in KB)."""
+    stats_path = os.path.join(args.out, "child_rusage.txt")
+    try:
+        proc = subprocess.run([os.path.join(args.out, "rusage_exec"), stats_path] + cmd, cwd=cwd,
+                              capture_output=True, timeout=timeout)
+    except subprocess.TimeoutExpired:
+        raise BenchFailure(f"{os.path.basename(cmd[0])} timed out after {timeout}s")
+    if proc.returncode != 0:
+        raise BenchFailure(f"{' '.join(cmd)} exited with {proc.returncode}: "
+                           f"{proc.stderr.decode(errors='replace').strip()}")
+    with open(stats_path) as f:
+        stats = key_values(f.read())
+    return proc.stdout.decode(errors="replace"), float(stats["wall_s"]), int(stats["peak_rss_kb"])
+
+
+def key_values(text):
+    """Parses 'key value' lines as printed by exam_loadgen and produ_consumer -n."""
+    values = {}
+    for line in text.splitlines():
+        parts = line.split()
+        if len(parts) == 2 and not line.startswith("#"):
+            values[parts[0]] = parts[1]
+    return values
+
+
+def histogram_line(text, name):
+    """Returns the fields of an exam_loadgen histogram line."""
+    for line in text.splitlines():
+        if line.startswith(name + " "):
+            return dict(field.split("=") for field in line.split()[1:])
+    raise BenchFailure(f"no {name} histogram in loadgen results")
+
+
+def median_metrics(samples):
+    """Median of each metric over the repeats."""
+    merged = {}
+    for metric in METRICS:
+        values = [s[metric] for s in samples if s.get(metric) is not None]
+        if values:
+            merged[metric] = round(statistics.median(values), 6)
+    return merged
+
+
+#Input generation, all from fixed seeds
+
+def generate_sensor_log(path, lines):
+    rng = random.Random(2)
+    with open(path, "w", newline="\n") as f:
+        for _ in range(lines):
+            #Same shape as 2/sensor_log.txt: readings with the odd blank line
+            f.write("\n" if rng.random() < 0.05 else f"{rng.randint(10, 45)}\n")
+
+
+def generate_temperatures(size):
+    rng = random.Random(3)
+    return [rng.gauss(22.0, 3.0) for _ in range(size)]
+
+
+def generate_roster(path, names):
+    rng = random.Random(1)
+    first = ["Sipho", "Amina", "John", "Zanele", "Li", "Maria", "Ngozi", "Ahmed", "Thandi", "Kwame"]
+    with open(path, "w", newline="\n") as f:
+        for i in range(names):
+            if rng.random() < 0.3:
+                f.write(f"Student{rng.randrange(10 ** 8):08d}\n")
+            else:
+                surname = "".join(rng.choice("abcdefghijklmnopqrstuvwxyz") for _ in range(rng.randint(3, 12)))
+                f.write(f"{rng.choice(first)} {surname.capitalize()}\n")
+
+
+def generate_elf_tree(path, copies):
+    """Hard links the repo's binaries into a directory tree, so nothing is copied.
+
+    The tree is kept between runs: a freshly rebuilt tree of thousands of links
+    is measurably slower to walk for a while, which showed up as noise.
+    """
+    binaries = [os.path.join(ROOT, p) for p in ("1/question1", "2/sensor_log", "2/sensor_log.o", "5/exam_server")]
+    binaries += [os.path.join(args.out, p) for p in ("exam_server", "exam_loadgen", "sort_students", "elf_inspect")]
+    stamp = os.path.join(path, ".complete")
+    if os.path.exists(stamp):
+        with open(stamp) as f:
+            if f.read() == f"{copies} {len(binaries)}":
+                return copies * len(binaries)
+
+    shutil.rmtree(path, ignore_errors=True)
+    files = 0
+    for i in range(copies):
+        target = os.path.join(path, f"release{i % 16:02d}", f"build{i:04d}")
+        os.makedirs(target)
+        for n, binary in enumerate(binaries):
+            #Distinct names, a clash would make copyfile write through a link into the repo
+            destination = os.path.join(target, f"{n}_{os.path.basename(binary)}")
+            try:
+                os.link(binary, destination)
+            except OSError:
+                shutil.copyfile(binary, destination)
+            files += 1
+        #Non-ELF noise the walker has to skip
+        with open(os.path.join(target, "README.txt"), "w") as f:
+            f.write("release notes\n")
+    with open(stamp, "w") as f:
+        f.write(f"{copies} {len(binaries)}")
+    return files
+
+
+#Benchmarks
+
+def bench_sensor_log():
+    """2/sensor_log counting a large log. It opens sensor_log.txt in its cwd.
+
+    Like elf_inspect it finishes in tens of milliseconds, so it gets extra repeats.
+    """
+    lines = 2_000_000
+    work = os.path.join(args.out, "sensor_log")
+    os.makedirs(work, exist_ok=True)
+    binary = os.path.join(work, "sensor_log")
+    shutil.copyfile(os.path.join(ROOT, "2", "sensor_log"), binary)
+    os.chmod(binary, 0o755)
+    generate_sensor_log(os.path.join(work, "sensor_log.txt"), lines)
+
+    samples = []
+    for _ in range(args.repeats + 4):
+        out, wall, rss = run_child([binary], cwd=work)
+        match = re.search(r"Total sensor readings:\D*(\d+)", out)
+        #The program counts newlines plus one for the last line
+        if not match or int(match.group(1)) != lines + 1:
+            raise BenchFailure(f"sensor_log counted {out.strip()!r}, expected {lines + 1}")
+        samples.append({"wall_s": wall, "throughput": lines / wall, "peak_rss_kb": rss})
+    return median_metrics(samples)
+
+
+def bench_tempstats():
+    """All five tempstats reductions over float arrays, in a child interpreter."""
+    samples = []
+    for _ in range(args.repeats):
+        out, wall, rss = run_child([sys.executable, os.path.abspath(__file__), "--tempstats-child",
+                                    "--out", args.out])
+        result = json.loads(out)
+        samples.append({"wall_s": result["wall_s"], "throughput": result["throughput"],
+                        "p99_us": result["p99_us"], "peak_rss_kb": rss})
+    return median_metrics(samples)
+
+
+def tempstats_child():
+    """Runs inside the child process so its peak RSS is the extension's alone."""
+    sys.path.insert(0, os.path.join(args.out, "py"))
+    import tempstats
+
+    #Check the answers on a smaller array against Python's own statistics
+    check = generate_temperatures(10_000)
+    expected = {
+        "min_temp": min(check),
+        "max_temp": max(check),
+        "avg_temp": statistics.fmean(check),
+        "variance_temp": statistics.variance(check),
+        "count_readings": len(check),
+    }
+    for name, want in expected.items():
+        got = getattr(tempstats, name)(check)
+        if abs(got - want) > 1e-9 * max(1.0, abs(want)):
+            raise SystemExit(f"tempstats.{name} returned {got}, expected {want}")
+
+    readings = generate_temperatures(1_000_000)
+    latencies = []
+    elements = 0
+    started = time.perf_counter()
+    for _ in range(4):
+        for name in expected:
+            call_started = time.perf_counter()
+            getattr(tempstats, name)(readings)
+            latencies.append((time.perf_counter() - call_started) * 1e6)
+            elements += len(readings)
+    wall = time.perf_counter() - started
+    latencies.sort()
+    print(json.dumps({
+        "wall_s": wall,
+        "throughput": elements / wall,
+        "p99_us": latencies[min(len(latencies) - 1, len(latencies) * 99 // 100)],
+    }))
+
+
+def bench_produ_consumer():
+    """4/produ_consumer in its -n benchmark mode, no sleeps."""
+    items = 500_000
+    binary = os.path.join(args.out, "produ_consumer")
+    samples = []
+    for _ in range(args.repeats):
+        out, wall, rss = run_child([binary, "-n", str(items)])
+        values = key_values(out)
+        if int(values.get("served", 0)) != items or int(values.get("prepared", 0)) != items:
+            raise BenchFailure(f"produ_consumer served {values.get('served')} of {items} drinks")
+        samples.append({"wall_s": wall, "throughput": float(values["items_per_s"]),
+                        "p99_us": float(values["p99_us"]), "peak_rss_kb": rss})
+    return median_metrics(samples)
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def peak_rss_of(pid):
+    with open(f"/proc/{pid}/status") as f:
+        for line in f:
+            if line.startswith("VmHWM:"):
+                return int(line.split()[1])
+    return None
+
+
+def bench_exam_server(journaled=False):
+    """Scripted exam sessions from exam_loadgen against exam_server over loopback.
+
+    The journaled variant writes a fresh results journal into --out each repeat,
+    so the fdatasync before every EXAM_END is part of what gets measured.
+    """
+    sessions = 3000
+    concurrency = 64
+    samples = []
+    for repeat in range(args.repeats):
+        port = free_port()
+        journal = "none"
+        if journaled:
+            journal = os.path.join(args.out, f"exam_results.{repeat}.journal")
+            if os.path.exists(journal):
+                os.remove(journal)
+        server = subprocess.Popen(
+            [os.path.join(args.out, "exam_server"), "-p", str(port), "-d", "0", "-c", str(concurrency),
+             "-w", "256", "-j", journal, "-m", "0", "-q", os.path.join(ROOT, "5", "questions.txt")],
+            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        try:
+            #Wait for the listener
+            deadline = time.time() + 5
+            while True:
+                try:
+                    socket.create_connection(("127.0.0.1", port), timeout=0.2).close()
+                    break
+                except OSError:
+                    if time.time() > deadline or server.poll() is not None:
+                        raise BenchFailure("exam_server did not start listening")
+                    time.sleep(0.05)
+
+            results = os.path.join(args.out, "loadgen_results.txt")
+            _, wall, _ = run_child([os.path.join(args.out, "exam_loadgen"), "-p", str(port),
+                                    "-n", str(sessions), "-c", str(concurrency), "-a", "A",
+                                    "-u", "bench", "-o", results])
+            rss = peak_rss_of(server.pid)
+        finally:
+            server.terminate()
+            server.wait()
+
+        with open(results) as f:
+            text = f.read()
+        values = key_values(text)
+        if int(values.get("sessions_completed", 0)) != sessions or int(values.get("sessions_failed", 1)) != 0:
+            raise BenchFailure(f"exam sessions: {values.get('sessions_completed')} completed, "
+                               f"{values.get('sessions_failed')} failed of {sessions}")
+        if journaled:
+            with open(journal) as f:
+                ended = sum(1 for line in f if line.startswith("END\t"))
+            if ended != sessions:
+                raise BenchFailure(f"journal holds {ended} END records, expected {sessions}")
+        samples.append({"wall_s": wall, "throughput": float(values["sessions_per_s"]),
+                        "p99_us": float(histogram_line(text, "question_rtt_us")["p99"]), "peak_rss_kb": rss})
+    return median_metrics(samples)
+
+
+def bench_sort_students():
+    """1/sort_students on a roster larger than its memory budget, so runs spill and merge."""
+    names = 1_000_000
+    roster = os.path.join(args.out, "students.txt")
+    output = os.path.join(args.out, "sorted_students.txt")
+    generate_roster(roster, names)
+    with open(roster, "rb") as f:
+        expected = sorted(f.read().split(b"\n")[:-1])
+
+    samples = []
+    for _ in range(args.repeats):
+        _, wall, rss = run_child([os.path.join(args.out, "sort_students"), "-i", roster, "-o", output,
+                                  "-m", "16", "-t", "4"])
+        with open(output, "rb") as f:
+            if f.read().split(b"\n")[:-1] != expected:
+                raise BenchFailure("sort_students output is not the sorted roster")
+        samples.append({"wall_s": wall, "throughput": names / wall, "peak_rss_kb": rss})
+    return median_metrics(samples)
+
+
+def bench_elf_inspect():
+    """1/elf_inspect over a release tree of hard-linked binaries."""
+    tree = os.path.join(args.out, "elf_tree")
+    files = generate_elf_tree(tree, 400)
+    #One unmeasured pass so every repeat sees warm directory caches
+    run_child([os.path.join(args.out, "elf_inspect"), "-q", tree])
+    samples = []
+    #Runs take tens of milliseconds, a few more repeats keep the median steady
+    for _ in range(args.repeats + 4):
+        out, wall, rss = run_child([os.path.join(args.out, "elf_inspect"), "-q", "-j", "4", tree])
+        reports = [line for line in out.splitlines() if line and not line.startswith(" ")]
+        if len(reports) != files:
+            raise BenchFailure(f"elf_inspect reported {len(reports)} of {files} binaries")
+        samples.append({"wall_s": wall, "throughput": files / wall, "peak_rss_kb": rss})
+    return median_metrics(samples)
+
+
+BENCHMARKS = {
+    "sensor_log": bench_sensor_log,
+    "tempstats": bench_tempstats,
+    "produ_consumer": bench_produ_consumer,
+    "exam_server": bench_exam_server,
+    "exam_journal": lambda: bench_exam_server(journaled=True),
+    "sort_students": bench_sort_students,
+    "elf_inspect": bench_elf_inspect,
+}
+
+
+#Baseline comparison
+
+def compare(name, current, baseline, tolerance):
+    """Returns a list of regression messages for one benchmark."""
+    problems = []
+    for metric, base in baseline.items():
+        value = current.get(metric)
+        if value is None or metric not in tolerance:
+            continue
+        relative = tolerance[metric]["relative"]
+        absolute = tolerance[metric]["absolute"]
+        if metric in HIGHER_IS_BETTER:
+            limit = base * (1 - relative) - absolute
+            if value < limit:
+                problems.append(f"{name}.{metric} {value:.6g} < {limit:.6g} (baseline {base:.6g})")
+        else:
+            limit = base * (1 + relative) + absolute
+            if value > limit:
+                problems.append(f"{name}.{metric} {value:.6g} > {limit:.6g} (baseline {base:.6g})")
+    return problems
+
+
+def print_table(results, baseline):
+    print(f"{'benchmark':<16}{'wall_s':>10}{'throughput/s':>16}{'p99_us':>12}{'peak_rss_kb':>14}   vs baseline")
+    for name, metrics in results.items():
+        base = baseline.get(name, {})
+        cells = []
+        for metric, width, fmt in (("wall_s", 10, ".3f"), ("throughput", 16, ",.0f"),
+                                   ("p99_us", 12, ".1f"), ("peak_rss_kb", 14, ",.0f")):
+            value = metrics.get(metric)
+            cells.append(f"{value:>{width}{fmt}}" if value is not None else f"{'-':>{width}}")
+        ratio = ""
+        if base.get("throughput") and metrics.get("throughput"):
+            ratio = f"   {metrics['throughput'] / base['throughput']:.2f}x throughput"
+        print(f"{name:<16}{''.join(cells)}{ratio}")
+
+
+def main():
+    if args.tempstats_child:
+        tempstats_child()
+        return 0
+
+    os.makedirs(args.out, exist_ok=True)
+    selected = args.only.split(",") if args.only else list(BENCHMARKS)
+
+    stored = {"tolerance": DEFAULT_TOLERANCE, "benchmarks": {}}
+    if os.path.exists(BASELINE):
+        with open(BASELINE) as f:
+            stored = json.load(f)
+    tolerance = stored.get("tolerance", DEFAULT_TOLERANCE)
+    baseline = stored.get("benchmarks", {})
+
+    results = {}
+    failures = []
+    for name in selected:
+        if name not in BENCHMARKS:
+            failures.append(f"unknown benchmark {name}")
+            continue
+        print(f"Running {name}...", flush=True)
+        try:
+            results[name] = BENCHMARKS[name]()
+        except BenchFailure as e:
+            failures.append(f"{name}: {e}")
+
+    print()
+    print_table(results, baseline)
+    with open(os.path.join(args.out, "results.json"), "w") as f:
+        json.dump(results, f, indent=2)
+
+    if args.update_baseline:
+        if failures:
+            print("\nNot updating the baseline, some benchmarks failed:", file=sys.stderr)
+            for failure in failures:
+                print(f"  FAILED {failure}", file=sys.stderr)
+            return 1
+        stored["tolerance"] = tolerance
+        stored.setdefault("benchmarks", {}).update(results)
+        with open(BASELINE, "w", newline="\n") as f:
+            json.dump(stored, f, indent=2)
+            f.write("\n")
+        print(f"\nBaseline written to {os.path.relpath(BASELINE, ROOT)}")
+        return 0
+
+    for name in results:
+        if name not in baseline:
+            print(f"\nNo baseline for {name}, run `make bench-baseline` to record one")
+            continue
+        failures += compare(name, results[name], baseline[name], tolerance)
+
+    if failures:
+        print("\nREGRESSIONS:", file=sys.stderr)
+        for failure in failures:
+            print(f"  FAILED {failure}", file=sys.stderr)
+        return 1
+    print("\nAll benchmarks within baseline tolerances")
+    return 0
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--out", default=os.path.join(ROOT, "bench", "_out"),
+                        help="directory holding the built programs and generated inputs")
+    parser.add_argument("--repeats", type=int, default=3, help="runs per benchmark, the median is kept")
+    parser.add_argument("--only", help="comma separated benchmarks to run")
+    parser.add_argument("--update-baseline", action="store_true", help="store these results as the baseline")
+    parser.add_argument("--tempstats-child", action="store_true", help=argparse.SUPPRESS)
+    args = parser.parse_args()
+    args.out = os.path.abspath(args.out)
+    sys.exit(main())
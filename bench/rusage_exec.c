@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/*
+ * Runs a command and writes its wall time and peak RSS to a file:
+ *
+ *   rusage_exec stats.txt ./program args...
+ *
+ * The benchmark runner goes through this instead of measuring its children
+ * directly. Linux carries the memory high-water mark of whatever process did
+ * the exec into the child's ru_maxrss, so a child spawned straight from the
+ * Python runner would report the interpreter's RSS. Forked from this small
+ * process the number is the program's own.
+ */
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s stats_file command [args...]\n", argv[0]);
+        return 2;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 2;
+    }
+    if (pid == 0) {
+        execvp(argv[2], &argv[2]);
+        perror(argv[2]);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        perror("wait4");
+        return 2;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    FILE *stats = fopen(argv[1], "w");
+    if (!stats) {
+        perror(argv[1]);
+        return 2;
+    }
+    fprintf(stats, "wall_s %.6f\n", (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    fprintf(stats, "peak_rss_kb %ld\n", usage.ru_maxrss);
+    fclose(stats);
+
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}